@@ -0,0 +1,69 @@
+// Bench.h
+// On-device microbenchmarks for the "bench" command. Each case runs a call a fixed number of
+// times between two micros() reads and prints:
+//   us/op      - wall time per call, interrupts (millis, SoftwareSerial) included
+//   cycles/op  - the same at F_CPU
+//   heap       - bytes the heap top grew during the case (String buffers kept or fragmented)
+// micros() ticks in 4 us steps on a 16 MHz board, so iteration counts keep each case at tens
+// of milliseconds. The loop itself (~1 us per iteration) is included.
+
+#ifndef BENCH_H
+#define BENCH_H
+
+#include <Arduino.h>
+#include <avr/wdt.h>
+
+extern char *__brkval;
+extern char __heap_start;
+
+class Bench {
+  public:
+    // discards output (a path under test that prints or sends frames)
+    struct NullPrint : public Print {
+      size_t write(uint8_t) { return 1; }
+      size_t write(const uint8_t *, size_t n) { return n; }
+    };
+
+    Bench(Print &out) : out(out) {
+      out.println(F("case                        us/op  cycles/op  heap"));
+    }
+
+    template<class Fn> void run(const __FlashStringHelper *name, uint16_t iters, Fn f) {
+      char *heapBefore = heapTop();
+      unsigned long t0 = micros();
+      for (uint16_t i = 0; i < iters; ++i) {
+        f();
+        asm volatile("" ::: "memory"); // keep every call's stores: no hoisting out of the loop
+      }
+      unsigned long us = micros() - t0;
+      wdt_reset();
+
+      out.print(name);
+      pad(strlen_P((const char *)name), 24);
+      unsigned long centi = us * 100UL / iters;
+      printRight(centi / 100, 6);
+      out.print('.');
+      if (centi % 100 < 10) out.print('0');
+      out.print(centi % 100);
+      printRight(us * (F_CPU / 1000000UL) / iters, 11);
+      printRight(heapTop() - heapBefore, 6);
+      out.println();
+    }
+
+  private:
+    Print &out;
+
+    static char *heapTop() { return __brkval ? __brkval : &__heap_start; }
+
+    void pad(size_t len, size_t width) {
+      while (len++ < width) out.print(' ');
+    }
+    void printRight(long v, uint8_t width) {
+      char buf[12];
+      ltoa(v, buf, 10);
+      pad(strlen(buf), width);
+      out.print(buf);
+    }
+};
+
+#endif
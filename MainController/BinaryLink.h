@@ -0,0 +1,164 @@
+// BinaryLink.h
+// Binary request/response + event protocol for fleet tooling, sharing Serial with the text UI
+// (host side: tools/motionlink.py).
+// - a frame is 0x00 | COBS(message | crc16 little endian) | 0x00. Text commands never start with
+//   0x00, so a leading zero byte switches the port into frame mode until the closing zero.
+// - crc16 is CRC-16/MCRF4XX (avr-libc _crc_ccitt_update from 0xFFFF), as in SerialExport.h
+// - message = type, tag, data. Replies set bit 7 of the request type and echo its tag, so a host
+//   can keep several requests in flight; unsolicited events carry tag 0.
+// - multi-byte fields are little endian
+// Frames are assembled without blocking; an incomplete one is dropped after LINK_RX_TIMEOUT_MS.
+
+#ifndef BINARY_LINK_H
+#define BINARY_LINK_H
+
+#include <Arduino.h>
+#include <util/crc16.h>
+
+#define LINK_RX_TIMEOUT_MS 200UL
+
+// message builder; a message that grows past MAX_LEN is marked overflowed and send() refuses it
+struct LinkMessage {
+  static const uint8_t MAX_LEN = 48;
+  uint8_t data[MAX_LEN];
+  uint8_t len;
+  bool overflow;
+
+  void begin(uint8_t type, uint8_t tag) { len = 0; overflow = false; u8(type); u8(tag); }
+  void u8(uint8_t v) {
+    if (len < MAX_LEN) data[len++] = v;
+    else overflow = true;
+  }
+  void u16(uint16_t v) { u8(v & 0xFF); u8(v >> 8); }
+  void u32(uint32_t v) { u16(v & 0xFFFF); u16(v >> 16); }
+  void bytes(const uint8_t *b, uint8_t n) { for (uint8_t i = 0; i < n; ++i) u8(b[i]); }
+
+  uint8_t type() const { return data[0]; }
+  uint8_t tag() const { return data[1]; }
+  // argument bytes after type and tag
+  const uint8_t *args() const { return data + 2; }
+  uint8_t argLen() const { return len > 2 ? len - 2 : 0; }
+};
+
+class BinaryLink {
+  public:
+    static const uint8_t VERSION = 1;
+
+    // host -> device
+    static const uint8_t MSG_PING = 0x01;        // -> PONG: version u8, millis u32
+    static const uint8_t MSG_GET_STATUS = 0x02;  // -> STATUS snapshot
+    static const uint8_t MSG_GET_COUNTERS = 0x03; // -> COUNTERS (Status::Counters, in order)
+    static const uint8_t MSG_COMMAND = 0x04;     // arg: CMD_* -> ACK: cmd u8, ok u8
+    // device -> host
+    static const uint8_t MSG_REPLY = 0x80;       // bit set on every reply
+    static const uint8_t MSG_NAK = 0xFF;         // unknown type / bad arguments / reply too long: type u8
+    static const uint8_t MSG_EVENT_READING = 0x90; // stored reading (see EEPROMStorage::Reading)
+    static const uint8_t MSG_EVENT_ALERT = 0x91;   // motion start: ts u32, channel u8
+
+    static const uint8_t CMD_SEND_NOW = 1;
+    static const uint8_t CMD_ESP_ON = 2;
+    static const uint8_t CMD_ESP_OFF = 3;
+    static const uint8_t CMD_SUBSCRIBE = 4;   // live events on
+    static const uint8_t CMD_UNSUBSCRIBE = 5;
+
+    // true while a frame is being received (the text UI must leave the port alone)
+    bool busy() const { return inFrame; }
+    bool subscribed() const { return eventsOn; }
+    void setSubscribed(bool on) { eventsOn = on; }
+
+    // Pull frame bytes from in. Returns true with msg filled when a frame with a good CRC has
+    // completed. Leaves text input untouched (returns false if the next byte is not 0x00).
+    bool poll(Stream &in, LinkMessage &msg) {
+      if (inFrame && millis() - lastByteTime > LINK_RX_TIMEOUT_MS) inFrame = false;
+      if (!inFrame) {
+        if (!in.available() || in.peek() != 0) return false;
+        in.read();
+        inFrame = true;
+        rxLen = 0;
+        rxOverflow = false;
+        lastByteTime = millis();
+      }
+      while (in.available()) {
+        uint8_t c = in.read();
+        lastByteTime = millis();
+        if (c != 0) {
+          if (rxLen < sizeof(rx)) rx[rxLen++] = c;
+          else rxOverflow = true;
+          continue;
+        }
+        // an empty frame is a leading delimiter after a trailing one: keep waiting
+        if (rxLen == 0) continue;
+        inFrame = false;
+        if (rxOverflow) { rxOverflow = false; return false; }
+        return decode(msg);
+      }
+      return false;
+    }
+
+    // COBS-encode msg with its CRC and write it as one frame; false (nothing written) if the
+    // message overflowed, so a cut-off payload never goes out with a valid CRC
+    bool send(Print &out, const LinkMessage &msg) {
+      if (msg.overflow) return false;
+      uint8_t raw[LinkMessage::MAX_LEN + 2];
+      memcpy(raw, msg.data, msg.len);
+      uint16_t crc = crc16(msg.data, msg.len);
+      raw[msg.len] = crc & 0xFF;
+      raw[msg.len + 1] = crc >> 8;
+      uint8_t n = msg.len + 2;
+
+      uint8_t enc[LinkMessage::MAX_LEN + 2 + 2];
+      uint8_t code = 1, codeAt = 0, e = 1;
+      for (uint8_t i = 0; i < n; ++i) {
+        if (raw[i] == 0) {
+          enc[codeAt] = code;
+          codeAt = e++;
+          code = 1;
+        } else {
+          enc[e++] = raw[i];
+          if (++code == 0xFF) { enc[codeAt] = code; codeAt = e++; code = 1; }
+        }
+      }
+      enc[codeAt] = code;
+      out.write((uint8_t)0);
+      out.write(enc, e);
+      out.write((uint8_t)0);
+      return true;
+    }
+
+  private:
+    uint8_t rx[LinkMessage::MAX_LEN + 2 + 2];
+    uint8_t rxLen = 0;
+    bool inFrame = false;
+    bool rxOverflow = false;
+    bool eventsOn = false;
+    unsigned long lastByteTime = 0;
+
+    static uint16_t crc16(const uint8_t *b, uint8_t n) {
+      uint16_t crc = 0xFFFF;
+      for (uint8_t i = 0; i < n; ++i) crc = _crc_ccitt_update(crc, b[i]);
+      return crc;
+    }
+
+    // COBS-decode rx into msg and check the CRC
+    bool decode(LinkMessage &msg) {
+      uint8_t out[sizeof(rx)];
+      uint8_t o = 0, i = 0;
+      while (i < rxLen) {
+        uint8_t code = rx[i++];
+        for (uint8_t k = 1; k < code; ++k) {
+          if (i >= rxLen) return false;
+          out[o++] = rx[i++];
+        }
+        if (code != 0xFF && i < rxLen) out[o++] = 0;
+      }
+      if (o < 4 || o - 2 > LinkMessage::MAX_LEN) return false;
+      uint16_t crc = out[o - 2] | (out[o - 1] << 8);
+      if (crc16(out, o - 2) != crc) return false;
+      msg.len = o - 2;
+      msg.overflow = false;
+      memcpy(msg.data, out, msg.len);
+      return true;
+    }
+};
+
+#endif
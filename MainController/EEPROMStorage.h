@@ -1,48 +1,144 @@
 // EEPROMStorage.h
 // Circular buffer stored in EEPROM with minimized writes.
-// - header at address 0: uint8_t count, uint8_t head (index of oldest)
+// - header at address 0: uint8_t count, uint8_t head (index of oldest),
+//   uint8_t layout version, uint16_t next sequence number, uint8_t watchdog reset count,
+//   one uint8_t per consumer cursor (readings that consumer has taken, counted from head),
+//   uint8_t capacity the ring was formatted with
 // - readings start at address 16 (safe offset).
-// - each Reading stored as 4 bytes duration_ms (uint32_t) and 4 bytes timestamp (uint32_t) -> 8 bytes per entry.
-// - max entries = 10
+// - each Reading stored as 4 bytes duration_ms (uint32_t), 4 bytes timestamp (uint32_t),
+//   2 bytes sequence number (uint16_t), 1 byte flags (low nibble) + channel (high nibble)
+//   and 1 byte merged PIR pulse count -> 12 bytes per entry.
+// - max entries = EEPROM_MAX_ENTRIES (10; up to 84 fit a 1 KB EEPROM)
+// - peekRange()/popN() work on runs of readings: slots are fetched with block reads and the
+//   header is committed once per popN(), not once per reading. EEPROM reads (calls and bytes),
+//   byte writes and readings popped are counted in Status::Counters.
+// - consumers (cloud upload, local export) read through their own cursor and advance() it;
+//   a slot is reclaimed once every cursor is past it. A lossy cursor only gives way when the
+//   store is full: a new reading then drops the oldest one if no blocking cursor still needs
+//   it, and the lossy consumers that had not read it count it as lost.
+// - readings are stored in completion order, so with one PIR channel their end times
+//   (ts + duration) ascend within a boot and queryByEndTime() binary-searches the ring. A final
+//   record takes its checkpoint's slot, behind readings other channels stored meanwhile, which
+//   puts the order off by as much as that event's duration: once readings of more than one
+//   channel have been stored this boot, queryByEndTime() scans every record instead.
+// - an in-progress record (FLAG_IN_PROGRESS) that no consumer has read yet is overwritten by later
+//   checkpoints and by the final record of the same event, one per channel; the newest one of a
+//   channel left over after a reset is sealed as FLAG_PARTIAL.
 
 #ifndef EEPROM_STORAGE_H
 #define EEPROM_STORAGE_H
 
 #include <Arduino.h>
 #include <EEPROM.h>
+#include <avr/eeprom.h>
+#include "Status.h"
+
+// Ring capacity; changing it starts the store over on the next boot
+#define EEPROM_MAX_ENTRIES 10
 
 class EEPROMStorage {
   public:
-    static const uint8_t MAX_ENTRIES = 10;
+    static const uint8_t MAX_ENTRIES = EEPROM_MAX_ENTRIES;
+    static const uint8_t READING_BYTES = 12;
     struct Reading {
       uint32_t duration_ms;
       uint32_t ts; // recorded timestamp (millis at record or epoch)
+      uint16_t seq; // assigned by push(); uploaded with the reading so retries are idempotent
+      uint8_t flags; // FLAG_* below; uploaded as field4
+      uint8_t subEvents; // PIR pulses merged into this event (1 = no retrigger); uploaded as field5
+      uint8_t channel; // PIR zone 0..15; uploaded as field6
     };
 
-    void begin() {
+    // consumer cursors
+    enum Cursor : uint8_t { CURSOR_CLOUD = 0, CURSOR_EXPORT = 1, CURSOR_COUNT = 2 };
+
+    // Reading flags (bit 0 is the motion-start alert, which is never stored)
+    static const uint8_t FLAG_IN_PROGRESS = 0x02; // checkpoint of an event still in progress
+    static const uint8_t FLAG_PARTIAL = 0x04;     // event cut short by a reset; duration up to the last checkpoint
+    static const uint8_t FLAG_WARMUP = 0x08;      // started while the PIR was still settling after power-up
+
+    // statusPtr (optional) receives EEPROM write and queue high-water counters
+    void begin(Status *statusPtr = nullptr) {
+      status = statusPtr;
       // read header
-      count = EEPROM.read(0);
-      head = EEPROM.read(1);
-      if (count > MAX_ENTRIES) { count = 0; head = 0; }
+      count = readByte(0);
+      head = readByte(1);
+      nextSeq = readByte(3) | (readByte(4) << 8);
+      // rings from before the capacity byte were 10 entries
+      uint8_t capacity = readByte(ADDR_CAPACITY) == 0xFF ? 10 : readByte(ADDR_CAPACITY);
+      if (readByte(2) != LAYOUT_VERSION || capacity != MAX_ENTRIES || count > MAX_ENTRIES || head >= MAX_ENTRIES) {
+        // blank EEPROM, older record layout or resized ring: start over
+        count = 0; head = 0; nextSeq = 0;
+        writeByte(0, count);
+        writeByte(1, head);
+        writeByte(2, LAYOUT_VERSION);
+        writeSeq();
+        writeByte(5, 0);
+      }
+      writeByte(ADDR_CAPACITY, MAX_ENTRIES);
+      for (uint8_t c = 0; c < CURSOR_COUNT; ++c) {
+        cursorPos[c] = readByte(ADDR_CURSORS + c);
+        if (cursorPos[c] > count) setCursorPos(c, 0); // never written: start at the oldest
+      }
+      sealInProgress();
+      bootSeq = nextSeq;
+      bootChannels = 0;
     }
 
     bool isFull() const { return count >= MAX_ENTRIES; }
     bool isEmpty() const { return count == 0; }
-    bool hasPending() const { return !isEmpty(); }
+    // readings this consumer has not taken yet
+    uint8_t pending(uint8_t cursor = CURSOR_CLOUD) const { return count - cursorPos[cursor]; }
+    bool hasPending(uint8_t cursor = CURSOR_CLOUD) const { return pending(cursor) > 0; }
     uint8_t size() const { return count; }
+    // true if r was pushed since begin(); its ts is then on this boot's millis() clock
+    uint16_t bootSequence() const { return bootSeq; }
+    // changes whenever a reading is stored or rewritten
+    uint16_t nextSequence() const { return nextSeq; }
+    bool recordedThisBoot(const Reading &r) const {
+      return (uint16_t)(r.seq - bootSeq) < (uint16_t)(nextSeq - bootSeq);
+    }
 
     // add reading to next free slot in EEPROM (tail). Minimizes writes:
-    // only writes the reading bytes and updates count/head bytes.
+    // only writes the reading bytes and updates count/seq bytes.
+    // The reading's seq is ignored; the next sequence number is assigned here.
     bool push(const Reading &r) {
-      if (isFull()) return false;
+      if (isFull() && !overrunLossy()) return false;
       uint8_t tailIndex = (head + count) % MAX_ENTRIES;
-      writeReadingToEEPROM(tailIndex, r);
+      Reading stored = r;
+      stored.seq = nextSeq++;
+      writeReadingToEEPROM(tailIndex, stored);
+      bootChannels |= 1 << r.channel;
       ++count;
-      EEPROM.update(0, count);
+      writeByte(0, count);
+      writeSeq();
+      if (status && count > status->counters.queueHighWater) status->counters.queueHighWater = count;
       // head remains same
       return true;
     }
 
+    // Store a checkpoint or final record for the event that started at r.ts on r.channel. If that
+    // event's in-progress checkpoint is still unread it is overwritten in place (with a fresh seq,
+    // so an ack for the old contents cannot pop the new ones), even with other channels' readings
+    // stored after it; otherwise pushes.
+    bool pushOrReplace(const Reading &r) {
+      uint8_t pos;
+      if (findCheckpoint(r, pos)) {
+        Reading stored = r;
+        stored.seq = nextSeq++;
+        writeReadingToEEPROM((head + pos) % MAX_ENTRIES, stored);
+        writeSeq();
+        return true;
+      }
+      return push(r);
+    }
+
+    bool peekNewest(Reading &outR) {
+      if (isEmpty()) return false;
+      readReadingFromEEPROM((head + count - 1) % MAX_ENTRIES, outR);
+      return true;
+    }
+
     // peek oldest reading without removing
     bool peekOldest(Reading &outR) {
       if (isEmpty()) return false;
@@ -50,61 +146,378 @@ class EEPROMStorage {
       return true;
     }
 
+    // copy up to n readings, starting `start` places after the oldest, into out[];
+    // returns how many were copied
+    uint8_t peekRange(uint8_t start, uint8_t n, Reading *out) {
+      uint8_t done = 0;
+      uint8_t raw[RANGE_CHUNK * READING_BYTES];
+      while (done < n) {
+        uint8_t got = peekRaw(start + done, n - done < RANGE_CHUNK ? n - done : RANGE_CHUNK, raw);
+        if (!got) break;
+        for (uint8_t i = 0; i < got; ++i) decodeReading(raw + i * READING_BYTES, out[done + i]);
+        done += got;
+      }
+      return done;
+    }
+
+    // same, as stored bytes (READING_BYTES per reading, see encodeReading); out must
+    // hold n * READING_BYTES. Contiguous slots go in one block read, two if the ring wraps.
+    uint8_t peekRaw(uint8_t start, uint8_t n, uint8_t *out) {
+      if (start >= count) return 0;
+      if (n > count - start) n = count - start;
+      uint8_t index = (head + start) % MAX_ENTRIES;
+      uint8_t run = n < MAX_ENTRIES - index ? n : MAX_ENTRIES - index;
+      readBlock(out, (const void *)(uintptr_t)(ADDR_READINGS + index * READING_BYTES), run * READING_BYTES);
+      if (run < n)
+        readBlock(out + run * READING_BYTES, (const void *)(uintptr_t)ADDR_READINGS, (n - run) * READING_BYTES);
+      return n;
+    }
+
+    // remove the n oldest readings (after confirmed send) with one header update;
+    // returns how many were removed
+    uint8_t popN(uint8_t n) {
+      if (n > count) n = count;
+      if (!n) return 0;
+      // slots are not cleared; only head and count move
+      head = (head + n) % MAX_ENTRIES;
+      count -= n;
+      if (status) status->counters.readingsDrained += n;
+      writeByte(1, head);
+      writeByte(0, count);
+      // cursors count from head
+      for (uint8_t c = 0; c < CURSOR_COUNT; ++c) {
+        if (cursorPos[c] < n) lostCount[c] += n - cursorPos[c];
+        setCursorPos(c, cursorPos[c] > n ? cursorPos[c] - n : 0);
+      }
+      return n;
+    }
+
     // remove oldest (after confirmed send)
-    bool popOldest() {
-      if (isEmpty()) return false;
-      // optional: clear memory (not necessary). We'll just advance head & decrement count.
-      head = (head + 1) % MAX_ENTRIES;
-      if (count) --count;
-      EEPROM.update(1, head);
-      EEPROM.update(0, count);
-      return true;
+    bool popOldest() { return popN(1) == 1; }
+
+    // Consumer cursors. Blocking cursors (the default) hold readings until they advance past
+    // them; a lossy one is skipped forward when a push finds the store full (see push()).
+    void setCursorLossy(uint8_t cursor, bool lossy) {
+      if (lossy) lossyMask |= (1 << cursor);
+      else lossyMask &= ~(1 << cursor);
+    }
+
+    // next reading for this consumer, without taking it
+    bool peekNext(uint8_t cursor, Reading &outR) { return peekRange(cursorPos[cursor], 1, &outR) == 1; }
+    // up to n readings for this consumer, oldest first
+    uint8_t peekNext(uint8_t cursor, uint8_t n, Reading *out) { return peekRange(cursorPos[cursor], n, out); }
+
+    // mark n readings as taken by this consumer (one header byte), then reclaim what every
+    // cursor has passed; returns how many were taken
+    uint8_t advance(uint8_t cursor, uint8_t n) {
+      if (n > pending(cursor)) n = pending(cursor);
+      if (!n) return 0;
+      cursorPos[cursor] += n;
+      uint8_t reclaim = count;
+      for (uint8_t c = 0; c < CURSOR_COUNT; ++c)
+        if (cursorPos[c] < reclaim) reclaim = cursorPos[c];
+      // popN rewrites the cursor bytes relative to the new head; a single consumer that
+      // reclaims as it goes leaves its byte at 0 and costs no cursor write at all
+      if (!popN(reclaim)) setCursorPos(cursor, cursorPos[cursor]);
+      return n;
+    }
+
+    // readings reclaimed before this (lossy) consumer read them, since boot
+    uint16_t lost(uint8_t cursor) const { return lostCount[cursor]; }
+
+    // Readings of this boot whose event ended in [fromMs, toMs) (millis). All of them lie in
+    // positions first .. first+span-1 counted from the oldest (see peekRange()); with one channel
+    // they are exactly those positions (span == n), found with two binary searches plus one pass
+    // over the matches when totals are wanted. With several channels this is scanByEndTime().
+    struct Query {
+      uint8_t first;
+      uint8_t span;
+      uint8_t n;
+      unsigned long totalMs; // summed durations (if requested)
+      uint8_t probes;        // records read to locate the range
+    };
+    Query queryByEndTime(unsigned long fromMs, unsigned long toMs, bool withTotals) {
+      if (bootChannels & (bootChannels - 1)) return scanByEndTime(fromMs, toMs);
+      Query q = { 0, 0, 0, 0, 0 };
+      // this boot's readings are the newest ones; their seqs ascend along the ring
+      uint8_t lo = 0, hi = count;
+      while (lo < hi) {
+        uint8_t mid = lo + (hi - lo) / 2;
+        Reading r;
+        readReadingFromEEPROM((head + mid) % MAX_ENTRIES, r);
+        ++q.probes;
+        if (recordedThisBoot(r)) hi = mid; else lo = mid + 1;
+      }
+      uint8_t bootStart = lo;
+      q.first = endTimeBound(bootStart, fromMs, q.probes);
+      q.n = endTimeBound(q.first, toMs, q.probes) - q.first;
+      q.span = q.n;
+      if (withTotals) {
+        Reading batch[RANGE_CHUNK];
+        for (uint8_t i = 0; i < q.n; i += RANGE_CHUNK) {
+          uint8_t got = peekRange(q.first + i, q.n - i < RANGE_CHUNK ? q.n - i : RANGE_CHUNK, batch);
+          for (uint8_t j = 0; j < got; ++j) q.totalMs += batch[j].duration_ms;
+        }
+      }
+      return q;
+    }
+
+    // the same by reading every record, oldest first (totals always); probes counts them.
+    // Needed once channels interleave, and serial "query ... scan" measures the search against it
+    Query scanByEndTime(unsigned long fromMs, unsigned long toMs) {
+      Query q = { 0, 0, 0, 0, 0 };
+      Reading batch[RANGE_CHUNK];
+      for (uint8_t i = 0; i < count; i += RANGE_CHUNK) {
+        uint8_t got = peekRange(i, count - i < RANGE_CHUNK ? count - i : RANGE_CHUNK, batch);
+        for (uint8_t j = 0; j < got; ++j) {
+          const Reading &r = batch[j];
+          ++q.probes;
+          if (!endsIn(r, fromMs, toMs)) continue;
+          if (!q.n) q.first = i + j;
+          q.span = i + j + 1 - q.first;
+          ++q.n;
+          q.totalMs += r.duration_ms;
+        }
+      }
+      return q;
+    }
+
+    // the readings q matched, one line each (others inside its span are skipped)
+    void printQuery(Print &out, const Query &q, unsigned long fromMs, unsigned long toMs) {
+      Reading batch[RANGE_CHUNK];
+      for (uint8_t i = 0; i < q.span; i += RANGE_CHUNK) {
+        uint8_t got = peekRange(q.first + i, q.span - i < RANGE_CHUNK ? q.span - i : RANGE_CHUNK, batch);
+        for (uint8_t j = 0; j < got; ++j)
+          if (endsIn(batch[j], fromMs, toMs)) printReading(out, q.first + i + j, batch[j]);
+        if (got < RANGE_CHUNK) break;
+      }
+    }
+
+    // resets by the AVR watchdog, kept across reboots (saturates at 255; clearAll() keeps it)
+    uint8_t watchdogResets() const { return readByte(5); }
+    uint8_t noteWatchdogReset() {
+      uint8_t n = readByte(5);
+      if (n < 255) writeByte(5, ++n);
+      return n;
+    }
+
+    // drop all readings; the sequence counter keeps running so
+    // sequence numbers are never reused for different readings
+    void clearAll() {
+      Reading blank = { 0, 0, 0, 0, 0, 0 };
+      for (uint8_t i = 0; i < MAX_ENTRIES; ++i) writeReadingToEEPROM(i, blank);
+      count = 0;
+      head = 0;
+      writeByte(1, head);
+      writeByte(0, count);
+      for (uint8_t c = 0; c < CURSOR_COUNT; ++c) setCursorPos(c, 0);
     }
 
     // print a short summary
     void printSummary(Print &out) {
-      out.print("Entries: "); out.print((int)count);
-      out.print("  head: "); out.print((int)head);
+      out.print(F("Entries: ")); out.print((int)count);
+      out.print(F("  head: ")); out.print((int)head);
+      out.print(F("  unsent: ")); out.print((int)pending(CURSOR_CLOUD));
+      out.print(F("  unexported: ")); out.print((int)pending(CURSOR_EXPORT));
+      if (lostCount[CURSOR_EXPORT]) { out.print(F("  export lost: ")); out.print(lostCount[CURSOR_EXPORT]); }
     }
 
     void printAll(Print &out) {
-      out.println("EEPROM Stored Readings:");
-      for (uint8_t i = 0; i < count; ++i) {
-        uint8_t idx = (head + i) % MAX_ENTRIES;
-        Reading r;
-        readReadingFromEEPROM(idx, r);
-        out.print(i); out.print(": duration_ms="); out.print(r.duration_ms); out.print(" ts=");
-        out.println(r.ts);
+      out.println(F("EEPROM Stored Readings:"));
+      printRange(out, 0, count);
+    }
+
+    // positions first .. first+n-1 (from the oldest), one line each
+    void printRange(Print &out, uint8_t first, uint8_t n) {
+      Reading batch[RANGE_CHUNK];
+      for (uint8_t i = 0; i < n; i += RANGE_CHUNK) {
+        uint8_t got = peekRange(first + i, n - i < RANGE_CHUNK ? n - i : RANGE_CHUNK, batch);
+        for (uint8_t j = 0; j < got; ++j) printReading(out, first + i + j, batch[j]);
+        if (got < RANGE_CHUNK) break;
       }
     }
 
+    // Record layout (little endian): duration_ms u32, ts u32, seq u16, flags | channel << 4,
+    // subEvents. Reading -> 12 stored bytes
+    static void encodeReading(const Reading &r, uint8_t *b) {
+      for (uint8_t i = 0; i < 4; ++i) b[i] = (r.duration_ms >> (8 * i)) & 0xFF;
+      for (uint8_t i = 0; i < 4; ++i) b[4 + i] = (r.ts >> (8 * i)) & 0xFF;
+      b[8] = r.seq & 0xFF;
+      b[9] = r.seq >> 8;
+      b[10] = (r.flags & 0x0F) | (r.channel << 4);
+      b[11] = r.subEvents;
+    }
+    // 12 stored bytes -> Reading
+    static void decodeReading(const uint8_t *b, Reading &r) {
+      r.duration_ms = b[0] | ((uint16_t)b[1] << 8) | ((uint32_t)b[2] << 16) | ((uint32_t)b[3] << 24);
+      r.ts = b[4] | ((uint16_t)b[5] << 8) | ((uint32_t)b[6] << 16) | ((uint32_t)b[7] << 24);
+      r.seq = b[8] | ((uint16_t)b[9] << 8);
+      r.flags = b[10] & 0x0F;
+      r.channel = b[10] >> 4;
+      r.subEvents = b[11];
+    }
+
   private:
     uint8_t count = 0;
     uint8_t head = 0;
+    uint16_t nextSeq = 0;
+    uint16_t bootSeq = 0; // nextSeq at begin(): older seqs come from before the reset
+    uint16_t bootChannels = 0; // channels pushed since begin(): more than one breaks end-time order
+    uint8_t cursorPos[CURSOR_COUNT] = {};  // readings taken by each consumer, from head
+    uint16_t lostCount[CURSOR_COUNT] = {};
+    uint8_t lossyMask = 1 << CURSOR_EXPORT; // export must not hold up the upload unless asked to
+    Status *status = nullptr;
+
+    // EEPROM.update() semantics (write only if changed), counting real writes
+    void writeByte(uint16_t addr, uint8_t v) {
+      if (readByte(addr) == v) return;
+      EEPROM.write(addr, v);
+      if (status) status->counters.eepromWrites++;
+    }
+    // EEPROM.read() / eeprom_read_block(), counted
+    uint8_t readByte(uint16_t addr) const {
+      if (status) { status->counters.eepromReads++; status->counters.eepromReadBytes++; }
+      return EEPROM.read(addr);
+    }
+    void readBlock(void *dst, const void *src, size_t n) const {
+      if (status) { status->counters.eepromReads++; status->counters.eepromReadBytes += n; }
+      eeprom_read_block(dst, src, n);
+    }
     static const uint16_t ADDR_HEADER = 0;
+    static const uint16_t ADDR_CURSORS = 6;   // one byte per cursor
+    static const uint16_t ADDR_CAPACITY = ADDR_CURSORS + CURSOR_COUNT;
     static const uint16_t ADDR_READINGS = 16; // start addr for readings
-    static const uint16_t READING_BYTES = 8;
+    static const uint8_t LAYOUT_VERSION = 4; // bump when the record layout changes
+    static_assert(ADDR_CAPACITY < ADDR_READINGS, "header overlaps the readings");
+    static_assert(MAX_ENTRIES >= 1 && ADDR_READINGS + MAX_ENTRIES * READING_BYTES <= 1024, "ring must fit a 1 KB EEPROM");
+    static const uint8_t RANGE_CHUNK = 4; // slots per block read (stack buffer of 48 bytes)
+
+    void printReading(Print &out, uint8_t pos, const Reading &r) {
+      out.print(pos); out.print(F(": duration_ms=")); out.print(r.duration_ms); out.print(F(" ts="));
+      out.print(r.ts); out.print(F(" seq=")); out.print(r.seq);
+      if (r.flags & FLAG_IN_PROGRESS) out.print(F(" (in progress)"));
+      if (r.flags & FLAG_PARTIAL) out.print(F(" (partial)"));
+      if (r.flags & FLAG_WARMUP) out.print(F(" (warm-up)"));
+      if (r.subEvents > 1) { out.print(F(" merged=")); out.print(r.subEvents); }
+      if (r.channel) { out.print(F(" ch=")); out.print(r.channel); }
+      if (pos < cursorPos[CURSOR_CLOUD]) out.print(F(" (sent)"));
+      out.println();
+    }
+
+    bool endsIn(const Reading &r, unsigned long fromMs, unsigned long toMs) const {
+      unsigned long end = r.ts + r.duration_ms;
+      return recordedThisBoot(r) && end >= fromMs && end < toMs;
+    }
+
+    // first position in [lo, count) whose event ended at or after t
+    uint8_t endTimeBound(uint8_t lo, unsigned long t, uint8_t &probes) {
+      uint8_t hi = count;
+      while (lo < hi) {
+        uint8_t mid = lo + (hi - lo) / 2;
+        Reading r;
+        readReadingFromEEPROM((head + mid) % MAX_ENTRIES, r);
+        ++probes;
+        if (r.ts + r.duration_ms < t) lo = mid + 1; else hi = mid;
+      }
+      return lo;
+    }
+
+    void setCursorPos(uint8_t cursor, uint8_t pos) {
+      cursorPos[cursor] = pos;
+      writeByte(ADDR_CURSORS + cursor, pos);
+    }
+
+    // store full: drop the oldest reading if only lossy consumers are still to read it
+    // (popN() counts it as lost for them)
+    bool overrunLossy() {
+      for (uint8_t c = 0; c < CURSOR_COUNT; ++c)
+        if (!(lossyMask & (1 << c)) && cursorPos[c] == 0) return false;
+      return popN(1) == 1;
+    }
+
+    // slots from this position on have not been read by any consumer and may be rewritten in place
+    uint8_t unreadFrom() const {
+      uint8_t pos = 0;
+      for (uint8_t c = 0; c < CURSOR_COUNT; ++c)
+        if (cursorPos[c] > pos) pos = cursorPos[c];
+      return pos;
+    }
+
+    // position of r's event checkpoint if it is unread: a channel's open event is always its
+    // newest reading, so the search stops at the first reading of r.channel from the tail
+    bool findCheckpoint(const Reading &r, uint8_t &pos) {
+      uint8_t from = unreadFrom();
+      for (pos = count; pos > from; ) {
+        Reading n;
+        readReadingFromEEPROM((head + --pos) % MAX_ENTRIES, n);
+        if (n.channel != r.channel) continue;
+        return (n.flags & FLAG_IN_PROGRESS) && n.ts == r.ts;
+      }
+      return false;
+    }
+
+    // an in-progress checkpoint that survived a reset is the best duration we will get for that
+    // event; only a channel's newest reading can be one (older ones were superseded)
+    void sealInProgress() {
+      uint16_t seen = 0; // channels whose newest reading has been looked at
+      uint8_t readPos[16]; // checkpoints a consumer already has, newest first
+      uint8_t nRead = 0;
+      for (uint8_t pos = count; pos > 0; ) {
+        Reading r;
+        readReadingFromEEPROM((head + --pos) % MAX_ENTRIES, r);
+        if (seen & (1 << r.channel)) continue;
+        seen |= 1 << r.channel;
+        if (!(r.flags & FLAG_IN_PROGRESS)) continue;
+        if (pos < unreadFrom()) readPos[nRead++] = pos;
+        else sealAt(pos, r);
+      }
+      // those get the sealed record as a new reading. Pushing only starts once the ring has been
+      // walked, oldest first: a push into a full store can reclaim the oldest slot and shift every
+      // position down by one, which `shift` follows (the k-th of them sits at k or later, so it
+      // is still there when its turn comes)
+      uint8_t shift = 0;
+      while (nRead) {
+        uint8_t pos = readPos[--nRead] - shift;
+        Reading r;
+        readReadingFromEEPROM((head + pos) % MAX_ENTRIES, r);
+        r.flags = (r.flags & ~FLAG_IN_PROGRESS) | FLAG_PARTIAL;
+        uint8_t before = count;
+        if (push(r)) {
+          if (count == before) ++shift; // full: the oldest reading made room
+        } else {
+          // full and held by a blocking consumer: seal the slot itself, so consumers that have
+          // not reached it yet see the partial record and none is left in progress
+          sealAt(pos, r);
+        }
+      }
+    }
+
+    void sealAt(uint8_t pos, Reading r) {
+      r.flags = (r.flags & ~FLAG_IN_PROGRESS) | FLAG_PARTIAL;
+      r.seq = nextSeq++;
+      writeReadingToEEPROM((head + pos) % MAX_ENTRIES, r);
+      writeSeq();
+    }
+
+    void writeSeq() {
+      writeByte(3, nextSeq & 0xFF);
+      writeByte(4, (nextSeq >> 8) & 0xFF);
+    }
 
     void writeReadingToEEPROM(uint8_t index, const Reading &r) {
       uint16_t addr = ADDR_READINGS + index * READING_BYTES;
-      // write 4 bytes duration_ms then 4 bytes ts; use EEPROM.update to minimize writes
-      EEPROM.update(addr + 0, (r.duration_ms >> 0) & 0xFF);
-      EEPROM.update(addr + 1, (r.duration_ms >> 8) & 0xFF);
-      EEPROM.update(addr + 2, (r.duration_ms >> 16) & 0xFF);
-      EEPROM.update(addr + 3, (r.duration_ms >> 24) & 0xFF);
-      EEPROM.update(addr + 4, (r.ts >> 0) & 0xFF);
-      EEPROM.update(addr + 5, (r.ts >> 8) & 0xFF);
-      EEPROM.update(addr + 6, (r.ts >> 16) & 0xFF);
-      EEPROM.update(addr + 7, (r.ts >> 24) & 0xFF);
+      uint8_t raw[READING_BYTES];
+      encodeReading(r, raw);
+      // writeByte skips unchanged bytes to minimize writes
+      for (uint8_t i = 0; i < READING_BYTES; ++i) writeByte(addr + i, raw[i]);
     }
 
     void readReadingFromEEPROM(uint8_t index, Reading &r) {
-      uint16_t addr = ADDR_READINGS + index * READING_BYTES;
-      uint32_t v0 = EEPROM.read(addr) | (EEPROM.read(addr + 1) << 8) | (EEPROM.read(addr + 2) << 16) | (EEPROM.read(addr + 3) << 24);
-      uint32_t v1 = EEPROM.read(addr + 4) | (EEPROM.read(addr + 5) << 8) | (EEPROM.read(addr + 6) << 16) | (EEPROM.read(addr + 7) << 24);
-      r.duration_ms = v0;
-      r.ts = v1;
+      uint8_t raw[READING_BYTES];
+      readBlock(raw, (const void *)(uintptr_t)(ADDR_READINGS + index * READING_BYTES), READING_BYTES);
+      decodeReading(raw, r);
     }
+
 };
 
 #endif
@@ -1,8 +1,16 @@
 // ESP01Driver.h
 // Manages SoftwareSerial communication with ESP01 (AT commands).
-// Boot control via a power pin (optional).
+// Boot control via a power pin (optional): RuntimePowerPin takes the pin at construction,
+// FixedPowerPin<PIN> resolves it at compile time (FixedPowerPin<-1> = no power pin, no code).
+// Debug echo of AT traffic is a compile-time feature set (EspDefaultFeatures / EspQuietFeatures).
 // Sends ThingSpeak updates via TCP using AT commands.
-// Waits and parses responses and signals success to EEPROMStorage to pop entries.
+// Optional transparent (pass-through, AT+CIPMODE=1) link: the connection stays open and
+// further requests stream straight through until "+++" drops back to command mode.
+// Waits and parses responses; pops an entry from EEPROMStorage only once ThingSpeak
+// has answered with a positive entry id for it (SEND OK alone is not a delivery).
+// A state held longer than its ESP_MAX_*_MS limit is broken by loop() (abandon send / restart).
+// Power-on never blocks: powerOn() raises the pin and enters BOOTING, then loop() steps the module
+// through settle, AT probe, baud negotiation and Wi-Fi join (see serviceBoot()).
 
 #ifndef ESP01_DRIVER_H
 #define ESP01_DRIVER_H
@@ -11,6 +19,7 @@
 #include <SoftwareSerial.h>
 #include "Status.h"
 #include "EEPROMStorage.h"
+#include "FastPin.h"
 
 // Replace with your ThingSpeak API key
 #define THINGSPEAK_API_KEY "YOUR_THINGSPEAK_API_KEY"
@@ -18,62 +27,203 @@
 #define WIFI_SSID "YOUR_SSID"
 #define WIFI_PASS "YOUR_PASSWORD"
 
-class ESP01Driver {
+// Pass-through link is closed after this long without a request
+#define PASSTHROUGH_IDLE_MS 30000UL
+// "+++" must be surrounded by at least 1 s of silence on the link
+#define PASSTHROUGH_GUARD_MS 1100UL
+
+// Link rate the ESP boots with (set once with AT+UART_DEF) and the fastest rate
+// tried at power-on with AT+UART_CUR. Set ESP_MAX_BAUD to ESP_BAUD_DEFAULT to skip negotiation.
+#define ESP_BAUD_DEFAULT 4800UL
+#define ESP_MAX_BAUD 38400UL
+
+// Longest ESP line kept; the rest of a longer line is dropped (only line starts are parsed)
+#define ESP_RX_LINE_MAX 64
+// Give up on a send this long after an RX overflow if the reply never completes
+#define ESP_RX_LOST_TIMEOUT_MS 5000UL
+// Reply to the AT+CIPCLOSE of an abandoned send is expected within this time
+#define ESP_CLOSE_REPLY_MS 2000UL
+// Longest the ESP may stay in one state before loop() steps in (0 = no limit): a stuck send is
+// abandoned, a stuck boot / error state power-cycles the module
+#define ESP_MAX_SENDING_MS 30000UL
+#define ESP_MAX_BOOTING_MS 30000UL
+#define ESP_MAX_ERROR_MS 30000UL
+// Longest extra field list a reading upload carries (occupancy summary + health status text)
+#define ESP_EXTRA_FIELDS_MAX 79
+// Payloads are written in slices of at most this much line time per call, so loop()
+// (and the PIR sampling in it) keeps running while a request goes out
+#define ESP_TX_SLICE_MS 8UL
+
+// ESP CH_PD/EN control, pin chosen at runtime (-1 = not wired)
+struct RuntimePowerPin {
+  int8_t pin;
+  RuntimePowerPin(int8_t p) : pin(p) {}
+  bool present() const { return pin >= 0; }
+  void begin() {
+    if (pin >= 0) {
+      pinMode(pin, OUTPUT);
+      digitalWrite(pin, LOW); // keep off by default
+    }
+  }
+  void set(bool on) { if (pin >= 0) digitalWrite(pin, on ? HIGH : LOW); }
+};
+
+// ESP CH_PD/EN control, pin fixed at compile time
+template<int8_t PIN>
+struct FixedPowerPin {
+  FixedPowerPin(int8_t = PIN) {}
+  static bool present() { return true; }
+  static void begin() {
+    FastPin<PIN>::write(false); // keep off by default
+    FastPin<PIN>::makeOutput();
+  }
+  static void set(bool on) { FastPin<PIN>::write(on); }
+};
+template<>
+struct FixedPowerPin<-1> {
+  FixedPowerPin(int8_t = -1) {}
+  static bool present() { return false; }
+  static void begin() {}
+  static void set(bool) {}
+};
+
+// Debug output compiled into the driver
+struct EspDefaultFeatures {
+  static const bool rawEcho = true;     // "[ESP RAW]" lines (toggle_esp_raw)
+  static const bool commandEcho = true; // "[ESP CMD]" lines
+};
+struct EspQuietFeatures {
+  static const bool rawEcho = false;
+  static const bool commandEcho = false;
+};
+
+template<class PowerPin = RuntimePowerPin, class Features = EspDefaultFeatures>
+class ESP01DriverT {
   public:
-    ESP01Driver(uint8_t rxPin, uint8_t txPin, int8_t powerPin = -1)
-      : ss(rxPin, txPin), powerPin(powerPin) { requestImmediateSend = false; }
+    // buffer sizes for the worst case: every reading field at its widest, ESP_EXTRA_FIELDS_MAX of
+    // extra fields, and the request around them (both include the terminating 0)
+    static const size_t FIELDS_LEN =
+      sizeof("field1=4294967295&field2=4294967295&field3=65535&field4=255&field5=255&field6=255") +
+      1 + ESP_EXTRA_FIELDS_MAX;
+    static const size_t REQUEST_LEN =
+      sizeof("GET /update?api_key=& HTTP/1.1\r\nHost: api.thingspeak.com\r\nConnection: keep-alive\r\n\r\n") - 1 +
+      sizeof(THINGSPEAK_API_KEY) - 1 + FIELDS_LEN;
+
+    ESP01DriverT(uint8_t rxPin, uint8_t txPin, int8_t powerPin = -1)
+      : ss(rxPin, txPin), power(powerPin) { requestImmediateSend = false; usePassthrough = false; }
 
     void begin(Status *statusPtr, EEPROMStorage *storagePtr) {
+      attach(statusPtr, storagePtr);
+      ss.begin(ESP_BAUD_DEFAULT);
+      linkBaud = ESP_BAUD_DEFAULT;
+      rxLen = 0;
+      power.begin();
+    }
+
+    // status/storage only; the port and power pin are left alone. With injectLine() this gives an
+    // offline driver (its port never begun, so commands it sends go nowhere) for the "bench" command.
+    void attach(Status *statusPtr, EEPROMStorage *storagePtr) {
       sysStatus = statusPtr;
       storage = storagePtr;
-      ss.begin(4800); // as requested
-      if (powerPin >= 0) {
-        pinMode(powerPin, OUTPUT);
-        digitalWrite(powerPin, LOW); // keep off by default
-      }
-      lastAtCheck = 0;
     }
+    // run one ESP reply line through the parser as if it had arrived
+    void injectLine(const String &line) { handleResponse(line); }
 
-    // power control
+    // power control; returns at once, loop() carries the boot on
     void powerOn() {
-      if (powerPin >= 0) {
-        digitalWrite(powerPin, HIGH);
-        delay(300); // let module settle
-      }
-      sysStatus->espState = Status::ESPState::BOOTING;
-      // flush serial buffer
-      while (ss.available()) ss.read();
-      // try to set up wifi connection
-      sendAt("AT\r\n"); // wake
-      delay(200);
-      configureWiFi();
+      power.set(true);
+      sysStatus->setEspState(Status::ESPState::BOOTING);
+      sysStatus->counters.espReboots++;
+      bootNegotiate = true;
+      enterBoot(BOOT_SETTLE, power.present() ? 300 : 0); // let module settle
     }
 
     void powerOff() {
-      if (powerPin >= 0) {
-        digitalWrite(powerPin, LOW);
-      }
-      sysStatus->espState = Status::ESPState::OFF;
+      power.set(false);
+      pendingPayload = "";
+      pendingSendState = 0;
+      txActive = false;
+      passthroughOpen = false;
+      escapeStep = 0;
+      bootStep = BOOT_IDLE;
+      closePending = false;
+      // UART_CUR is not persistent: the ESP comes back at its default rate
+      setLinkBaud(ESP_BAUD_DEFAULT);
+      sysStatus->setEspState(Status::ESPState::OFF);
     }
 
     // main state machine - call frequently
     void loop(bool showRawResponses) {
-      // read raw responses from ESP and process lines
+      // continue any payload still being written, then read responses from ESP and process lines
+      serviceTx();
+      pollRx(showRawResponses);
+
+      // power-on sequence, one step at a time
+      unsigned long now = millis();
+      if (bootStep != BOOT_IDLE) serviceBoot(now);
+
+      // idle pass-through link: leave data mode once the backlog is drained or nothing was sent for a while
+      if (passthroughOpen && pendingSendState == 0 && escapeStep == 0 &&
+          (!usePassthrough || (storage && !storage->hasPending()) || now - lastTxTime > PASSTHROUGH_IDLE_MS)) {
+        escapeStep = 1;
+        sysStatus->setEspState(Status::ESPState::SENDING); // link busy until back in command mode
+      }
+      if (closePending && now - closeSentAt > ESP_CLOSE_REPLY_MS) closePending = false; // reply lost
+      serviceEscape(now);
+      supervise(now);
+    }
+
+    // Drain the ESP port and dispatch complete lines. SoftwareSerial only buffers 64 bytes,
+    // so this must run at least every rxDrainIntervalMs(), not just once per loop().
+    void pollRx(bool showRawResponses) {
       while (ss.available()) {
-        String line = ss.readStringUntil('\n');
-        line.trim();
-        if (line.length() == 0) continue;
-        if (showRawResponses) {
-          Serial.print("[ESP RAW] "); Serial.println(line);
+        char c = ss.read();
+        lastRxTime = millis();
+        if (sysStatus) sysStatus->counters.rxBytes++;
+        if (c == '\n') {
+          dispatchRxLine(showRawResponses);
+          continue;
+        }
+        if (c == '>' && rxLen == 0 && pendingSendState == 2) {
+          // CIPSEND prompt is "> " with no line ending
+          rxLine[rxLen++] = c;
+          dispatchRxLine(showRawResponses);
+          continue;
         }
-        handleResponse(line);
+        if (rxLen < ESP_RX_LINE_MAX) rxLine[rxLen++] = c;
+        else rxTruncated = true;
       }
+      // a reply body without a line ending (e.g. keep-alive "123") is complete once the link goes quiet
+      if (rxLen && millis() - lastRxTime > 2 * rxDrainIntervalMs() + 10) dispatchRxLine(showRawResponses);
 
-      // periodic check: if it's booting, try to see if it responds
-      unsigned long now = millis();
-      if (sysStatus->espState == Status::ESPState::BOOTING && now - lastAtCheck > 2000) {
-        sendAt("AT\r\n");
-        lastAtCheck = now;
+      if (ss.overflow()) {
+        // bytes were lost; anything we are waiting for may never arrive
+        if (sysStatus) sysStatus->counters.rxOverflows++;
+        if (pendingSendState) rxLostSince = millis();
+      }
+      if (rxLostSince && pendingSendState && millis() - rxLostSince > ESP_RX_LOST_TIMEOUT_MS) {
+        Serial.println(F("[ESP] Reply lost in RX overflow - abandoning send, will retry."));
+        abandonSend();
+      }
+      if (!pendingSendState) rxLostSince = 0;
+    }
+
+    // time for SoftwareSerial's 64-byte buffer to half fill at the current link rate
+    unsigned long rxDrainIntervalMs() const {
+      unsigned long ms = 32UL * 10UL * 1000UL / linkBaud;
+      return ms ? ms : 1;
+    }
+
+    // idle for ms while keeping the ESP port drained (replaces a plain delay() in the main loop)
+    void idle(unsigned long ms, bool showRawResponses) {
+      unsigned long start = millis();
+      for (;;) {
+        serviceTx();
+        pollRx(showRawResponses);
+        unsigned long elapsed = millis() - start;
+        if (elapsed >= ms) break;
+        unsigned long step = txActive ? 1 : rxDrainIntervalMs();
+        delay(step < ms - elapsed ? step : ms - elapsed);
       }
     }
 
@@ -82,100 +232,717 @@ class ESP01Driver {
       return (sysStatus->espState == Status::ESPState::READY);
     }
 
-    // send a reading to ThingSpeak; returns true if start succeeded (CIPSTART issued)
-    bool sendReadingToThingSpeak(const EEPROMStorage::Reading &r) {
+    // send a reading to ThingSpeak; returns true if start succeeded (CIPSTART issued).
+    // extraFields ("field7=..&field8=..") rides along on the same request.
+    bool sendReadingToThingSpeak(const EEPROMStorage::Reading &r, const char *extraFields = nullptr) {
       if (!isReadyForSend()) return false;
-      // construct GET request
-      char buffer[200];
-      // field1 used for duration_ms, field2 for timestamp if desired
-      snprintf(buffer, sizeof(buffer),
-        "GET /update?api_key=%s&field1=%lu HTTP/1.1\r\nHost: api.thingspeak.com\r\nConnection: close\r\n\r\n",
-        THINGSPEAK_API_KEY, (unsigned long)r.duration_ms);
-      // Start TCP connection
-      sendAt("AT+CIPSTART=\"TCP\",\"api.thingspeak.com\",80\r\n");
-      delayingForResponse = true;
-      pendingPayload = String(buffer);
-      pendingSendState = 1; // next step after CIPSTART is to wait for "OK" then send CIPSEND
-      sysStatus->espState = Status::ESPState::SENDING;
+      char fields[FIELDS_LEN];
+      if (!formatReadingFields(fields, sizeof(fields), r, extraFields)) sysStatus->counters.fieldsTruncated++;
+      // same reading again after an attempt that was not acknowledged
+      if (retryPending && r.seq == inFlightSeq) sysStatus->counters.retries++;
+      retryPending = true; // cleared when ThingSpeak acknowledges it
+      inFlightKind = SEND_READING;
+      inFlightSeq = r.seq;
+      inFlightEventTime = r.ts + r.duration_ms; // event end
+      // ts of a reading from before the last reset is on the old millis() clock
+      inFlightTimed = !storage || storage->recordedThisBoot(r);
+      return startRequest(fields);
+    }
+
+    // field1 used for duration_ms, field2 for timestamp, field3 for the reading's
+    // sequence number (lets the consumer drop duplicates if an ack is lost and we retry),
+    // field4 for the reading's flags (in progress / partial), field5 for merged PIR pulses,
+    // field6 for the PIR channel
+    // false if the field list was cut to fit len
+    static bool formatReadingFields(char *buf, size_t len, const EEPROMStorage::Reading &r, const char *extraFields) {
+      int n = snprintf_P(buf, len, PSTR("field1=%lu&field2=%lu&field3=%u&field4=%u&field5=%u&field6=%u"),
+        (unsigned long)r.duration_ms, (unsigned long)r.ts, (unsigned)r.seq, (unsigned)r.flags,
+        (unsigned)r.subEvents, (unsigned)r.channel);
+      if (n < 0 || (size_t)n >= len) return false;
+      if (extraFields && extraFields[0]) {
+        int m = snprintf_P(buf + n, len - n, PSTR("&%s"), extraFields);
+        if (m < 0 || (size_t)m >= len - n) return false;
+      }
       return true;
     }
 
+    // the GET request around a field list
+    // false if the request was cut to fit len
+    static bool formatRequest(char *buf, size_t len, const char *fields, bool keepAlive) {
+      int n = snprintf_P(buf, len,
+        PSTR("GET /update?api_key=" THINGSPEAK_API_KEY "&%s HTTP/1.1\r\nHost: api.thingspeak.com\r\nConnection: %s\r\n\r\n"),
+        fields, keepAlive ? "keep-alive" : "close");
+      return n >= 0 && (size_t)n < len;
+    }
+
+    // send a motion-start alert (field4=1, field2=start time, field6=channel); bypasses the reading queue.
+    // field4 bit 0 is reserved for alerts, stored readings use the EEPROMStorage::FLAG_* bits
+    bool sendAlertToThingSpeak(unsigned long motionStartTs, uint8_t channel = 0) {
+      if (!isReadyForSend()) return false;
+      char fields[48];
+      snprintf_P(fields, sizeof(fields), PSTR("field2=%lu&field4=1&field6=%u"), motionStartTs, (unsigned)channel);
+      inFlightKind = SEND_ALERT;
+      inFlightEventTime = motionStartTs;
+      inFlightChannel = channel;
+      inFlightTimed = true;
+      alertDelivered = false;
+      return startRequest(fields);
+    }
+
+    // true once per alert that ThingSpeak has stored; motionStartTs / channel are the ones it reported
+    bool takeAlertDelivered(unsigned long &motionStartTs, uint8_t &channel) {
+      bool d = alertDelivered;
+      alertDelivered = false;
+      motionStartTs = deliveredAlertTs;
+      channel = deliveredAlertCh;
+      return d;
+    }
+
+    // millis() when ThingSpeak's last HTTP reply (entry id or "0") came in; 0 before the first.
+    // The server has the request by then, so its 15 s window is safe to time from here.
+    unsigned long lastReplyTime() const { return replyTime; }
+
     // call to show summary
     void printSummary(Print &out) {
-      out.print("ESPstate=");
+      out.print(F("ESPstate="));
       switch(sysStatus->espState) {
-        case Status::ESPState::OFF: out.print("OFF"); break;
-        case Status::ESPState::BOOTING: out.print("BOOTING"); break;
-        case Status::ESPState::READY: out.print("READY"); break;
-        case Status::ESPState::SENDING: out.print("SENDING"); break;
-        case Status::ESPState::ERROR: out.print("ERROR"); break;
+        case Status::ESPState::OFF: out.print(F("OFF")); break;
+        case Status::ESPState::BOOTING: out.print(F("BOOTING")); break;
+        case Status::ESPState::READY: out.print(F("READY")); break;
+        case Status::ESPState::SENDING: out.print(F("SENDING")); break;
+        case Status::ESPState::ERROR: out.print(F("ERROR")); break;
       }
-      out.print("  pendingSend="); out.print(pendingPayload.length() ? "YES" : "NO");
-      out.print("  reqSend="); out.print(requestImmediateSend ? "Y" : "N");
+      out.print(F("  pendingSend=")); out.print(pendingPayload.length() ? F("YES") : F("NO"));
+      out.print(F("  reqSend=")); out.print(requestImmediateSend ? 'Y' : 'N');
+      out.print(F("  passthrough=")); out.print(usePassthrough ? (passthroughOpen ? F("OPEN") : F("ON")) : F("OFF"));
+      // link cost of the last delivered request: bytes written to the ESP, wall time until the
+      // entry id arrived, and time SoftwareSerial TX spent with interrupts off (10 bit times per byte)
+      out.print(F("  baud=")); out.print(linkBaud);
+      out.print(F("  lastReqTx=")); out.print(lastRequestTxBytes);
+      out.print(F("B/")); out.print(lastRequestMs);
+      out.print(F("ms  txIrqOff(ms)=")); out.print(txIrqOffMs(lastRequestTxBytes));
+      // longest single blocking TX slice since power-on; interrupts are still off for
+      // 10 bit times inside every byte SoftwareSerial sends (2.1 ms at 4800 baud)
+      out.print(F("  txSliceMax(us)=")); out.print(txSliceMaxUs);
     }
 
     // public flag can be triggered by main to force immediate send
     bool requestImmediateSend;
+    // use the transparent (CIPMODE=1) link for uploads; meant for draining a backlog.
+    // Safe to change at any time: a request in flight finishes in the mode it started in,
+    // and an open link is closed by loop() once it is idle.
+    bool usePassthrough;
 
   private:
     SoftwareSerial ss;
-    int8_t powerPin;
+    PowerPin power;
     Status *sysStatus = nullptr;
     EEPROMStorage *storage = nullptr;
 
     // send buffer/payload management
     String pendingPayload = "";
-    int pendingSendState = 0; // 0 none, 1 waiting for CIPSTART OK, 2 waiting for '>' for CIPSEND
+    int pendingSendState = 0; // 0 none, 1 waiting for CIPSTART OK, 2 waiting for '>' for CIPSEND,
+                              // 3 waiting for SEND OK, 4 waiting for ThingSpeak's reply (+IPD),
+                              // 5 waiting for CIPMODE=1 OK (pass-through)
+    bool passthroughOpen = false; // ESP is in data mode, bytes go straight to the TCP peer
+    bool requestPassthrough = false; // link mode chosen when the in-flight request started
+    uint8_t escapeStep = 0; // 0 none, 1 guard before "+++", 2 guard after "+++", 3 waiting CIPCLOSE
+    unsigned long lastTxTime = 0;
+
+    // line assembly from the ESP port
+    char rxLine[ESP_RX_LINE_MAX + 1];
+    uint8_t rxLen = 0;
+    bool rxTruncated = false;
+    unsigned long lastRxTime = 0;
+    unsigned long rxLostSince = 0; // set when an overflow hit an in-flight send
+
+    void dispatchRxLine(bool showRawResponses) {
+      rxLine[rxLen] = 0;
+      rxLen = 0;
+      if (rxTruncated) {
+        rxTruncated = false;
+        if (sysStatus) sysStatus->counters.rxTruncatedLines++;
+      }
+      String line(rxLine);
+      line.trim();
+      if (line.length() == 0) {
+        // blank line separates HTTP headers from the body
+        if (httpState == HTTP_HEADERS) httpState = HTTP_BODY;
+        return;
+      }
+      if (Features::rawEcho && showRawResponses) {
+        Serial.print(F("[ESP RAW] ")); Serial.println(line);
+      }
+      handleResponse(line);
+    }
+
+    // link rate and per-request cost
+    unsigned long linkBaud = ESP_BAUD_DEFAULT;
+    unsigned long requestStartTime = 0;
+    uint16_t requestTxBytes = 0;
+    uint16_t lastRequestTxBytes = 0;
+    unsigned long lastRequestMs = 0;
+    unsigned long replyTime = 0;
+
+    unsigned long txIrqOffMs(uint16_t bytes) const {
+      return (unsigned long)bytes * 10UL * 1000UL / linkBaud;
+    }
+
+    void setLinkBaud(unsigned long baud) {
+      if (baud == linkBaud) return;
+      ss.end();
+      ss.begin(baud);
+      linkBaud = baud;
+    }
+
+    // Power-on sequence. Each step waits for a reply line (handleBootLine) or for its time limit
+    // (serviceBoot); nothing in it blocks loop().
+    //   SETTLE  module settling after power-up, then "AT"
+    //   PROBE   "AT" every 2 s until the first "OK"
+    //   RATE    AT+UART_CUR=<next rate> sent at the old rate, waiting for its "OK"
+    //   SWITCH  short pause, then the port changes to bootBaud and CHECK starts
+    //   CHECK   three plain "AT" round trips at bootBaud; any other line is noise at this rate
+    //   CYCLE   link stuck at an unknown rate: power held off before a fresh start
+    //   JOIN    AT+CWMODE=1 sent, then AT+CWJAP
+    //   WAIT_IP until "WIFI GOT IP" (READY); a failed join is left to the BOOTING dwell limit
+    enum BootStep : uint8_t { BOOT_IDLE, BOOT_SETTLE, BOOT_PROBE, BOOT_RATE, BOOT_SWITCH, BOOT_CHECK,
+                              BOOT_CYCLE, BOOT_JOIN, BOOT_WAIT_IP };
+    BootStep bootStep = BOOT_IDLE;
+    unsigned long bootStepAt = 0;  // when the current step started
+    unsigned long bootWaitMs = 0;  // its time limit
+    uint8_t bootRate = 0;          // index into bootRates()
+    unsigned long bootBaud = ESP_BAUD_DEFAULT; // rate CHECK runs at
+    bool bootFallback = false;     // CHECK is back at the default rate after a rate did not hold
+    bool bootNegotiate = true;     // cleared by a failed link check: join at the default rate
+    uint8_t bootChecks = 0;
+
+    static const unsigned long *bootRates(uint8_t &n) {
+      static const unsigned long rates[] = { 38400UL, 19200UL, 9600UL };
+      n = sizeof(rates) / sizeof(rates[0]);
+      return rates;
+    }
+
+    void enterBoot(BootStep step, unsigned long waitMs) {
+      bootStep = step;
+      bootStepAt = millis();
+      bootWaitMs = waitMs;
+    }
+
+    // time limits of the boot steps
+    void serviceBoot(unsigned long now) {
+      if (now - bootStepAt < bootWaitMs) return;
+      switch (bootStep) {
+        case BOOT_SETTLE:
+          while (ss.available()) ss.read(); // power-up noise
+          rxLen = 0;
+          sendAt(F("AT\r\n")); // wake
+          enterBoot(BOOT_PROBE, 2000);
+          break;
+        case BOOT_PROBE:
+          sendAt(F("AT\r\n")); // no answer yet: ask again
+          enterBoot(BOOT_PROBE, 2000);
+          break;
+        case BOOT_RATE:
+          ++bootRate; // rate not accepted
+          tryNextRate();
+          break;
+        case BOOT_SWITCH:
+          // the ESP acknowledged at the old rate and has switched by now
+          setLinkBaud(bootBaud);
+          while (ss.available()) ss.read();
+          rxLen = 0;
+          bootChecks = 0;
+          sendAt(F("AT\r\n"));
+          enterBoot(BOOT_CHECK, 300);
+          break;
+        case BOOT_CHECK:
+          linkCheckDone(false);
+          break;
+        case BOOT_CYCLE:
+          power.set(true);
+          sysStatus->counters.espReboots++;
+          enterBoot(BOOT_SETTLE, 300);
+          break;
+        case BOOT_JOIN:
+          joinWiFi();
+          break;
+        default:
+          break;
+      }
+    }
+
+    // reply lines during power-on; false lets the line through to handleResponse()
+    bool handleBootLine(const String &line) {
+      bool ok = line.equals("OK");
+      switch (bootStep) {
+        case BOOT_PROBE:
+          if (!ok) return true;
+          // module answers: step the link up to the fastest rate that holds, then join
+          bootRate = 0;
+          if (bootNegotiate && ESP_MAX_BAUD > ESP_BAUD_DEFAULT) tryNextRate();
+          else startJoin();
+          return true;
+        case BOOT_RATE:
+          if (ok) {
+            bootBaud = currentRate();
+            bootFallback = false;
+            enterBoot(BOOT_SWITCH, 20);
+          } else if (line.indexOf("ERROR") >= 0) {
+            ++bootRate;
+            tryNextRate();
+          }
+          return true;
+        case BOOT_CHECK:
+          if (ok) {
+            if (++bootChecks >= 3) linkCheckDone(true);
+            else { sendAt(F("AT\r\n")); enterBoot(BOOT_CHECK, 300); }
+          } else if (!line.startsWith("AT") && !isUnsolicited(line)) {
+            linkCheckDone(false); // anything else is line noise at this rate
+          }
+          return true;
+        case BOOT_JOIN:
+          if (ok) joinWiFi();
+          return true;
+        case BOOT_WAIT_IP:
+          return false;
+        default:
+          return true; // settle / power cycle: power-up noise
+      }
+    }
+
+    // lines the module sends on its own (auto-connect, reboot banner); arriving intact, they
+    // show the link is clean rather than noisy
+    static bool isUnsolicited(const String &line) {
+      return line.length() == 0 || line.equals("ready") || line.startsWith("WIFI ");
+    }
+
+    unsigned long currentRate() {
+      uint8_t n;
+      const unsigned long *rates = bootRates(n);
+      return rates[bootRate];
+    }
+
+    // ask for the next rate above the default that ESP_MAX_BAUD allows, or join once none is left
+    void tryNextRate() {
+      uint8_t n;
+      const unsigned long *rates = bootRates(n);
+      while (bootRate < n && (rates[bootRate] > ESP_MAX_BAUD || rates[bootRate] <= ESP_BAUD_DEFAULT)) ++bootRate;
+      if (bootRate >= n) {
+        startJoin();
+        return;
+      }
+      char cmd[40];
+      snprintf_P(cmd, sizeof(cmd), PSTR("AT+UART_CUR=%lu,8,1,0,0\r\n"), rates[bootRate]);
+      sendAt(cmd);
+      enterBoot(BOOT_RATE, 500);
+    }
+
+    void linkCheckDone(bool clean) {
+      if (clean) {
+        if (bootFallback) {
+          // back at the default rate: try the next one down
+          ++bootRate;
+          tryNextRate();
+        } else {
+          startJoin();
+        }
+        return;
+      }
+      if (!bootFallback) {
+        // ask the ESP to go back down, at the rate it is now listening on
+        char cmd[40];
+        snprintf_P(cmd, sizeof(cmd), PSTR("AT+UART_CUR=%lu,8,1,0,0\r\n"), ESP_BAUD_DEFAULT);
+        sendAt(cmd);
+        bootBaud = ESP_BAUD_DEFAULT;
+        bootFallback = true;
+        enterBoot(BOOT_SWITCH, 50);
+        return;
+      }
+      setLinkBaud(ESP_BAUD_DEFAULT);
+      if (power.present()) {
+        // module is stuck at an unknown rate; a power cycle restores its default
+        Serial.println(F("[ESP] Link check failed - power cycling."));
+        power.set(false);
+        bootNegotiate = false;
+        enterBoot(BOOT_CYCLE, 200);
+        return;
+      }
+      startJoin();
+    }
+
+    void startJoin() {
+      Serial.print(F("[ESP] Link baud = ")); Serial.println(linkBaud);
+      sendAt(F("AT+CWMODE=1\r\n")); // station
+      enterBoot(BOOT_JOIN, 200);
+    }
+
+    void joinWiFi() {
+      // connect to WiFi (may take a while); "WIFI GOT IP" in handleResponse() sets READY
+      sendAt(F("AT+CWJAP=\"" WIFI_SSID "\",\"" WIFI_PASS "\"\r\n"));
+      enterBoot(BOOT_WAIT_IP, 0);
+    }
+
+    // drop the in-flight request as failed (the reading stays queued) and free the link
+    void abandonSend() {
+      if (sysStatus) {
+        sysStatus->lastSendOk = false;
+        sysStatus->counters.sendsFailed++;
+      }
+      if (!passthroughOpen) {
+        sendAt(F("AT+CIPCLOSE\r\n"));
+        closePending = true;
+        closeSentAt = millis();
+      }
+      txActive = false;
+      pendingPayload = "";
+      pendingSendState = 0;
+      httpState = HTTP_NONE;
+      sysStatus->setEspState(Status::ESPState::READY);
+    }
+
+    // per-state dwell limits, see ESP_MAX_*_MS
+    void supervise(unsigned long now) {
+      unsigned long limit;
+      switch (sysStatus->espState) {
+        case Status::ESPState::SENDING: limit = ESP_MAX_SENDING_MS; break;
+        case Status::ESPState::BOOTING: limit = ESP_MAX_BOOTING_MS; break;
+        case Status::ESPState::ERROR: limit = ESP_MAX_ERROR_MS; break;
+        default: return;
+      }
+      if (!limit || now - sysStatus->espStateSince < limit) return;
+      sysStatus->counters.espRecoveries++;
+      if (sysStatus->espState == Status::ESPState::SENDING && !passthroughOpen && escapeStep == 0) {
+        // a lost reply: closing the socket is enough
+        Serial.println(F("[ESP] Send timed out - abandoning, will retry."));
+        abandonSend();
+        return;
+      }
+      Serial.print(F("[ESP] Stuck in state ")); Serial.print((int)sysStatus->espState);
+      Serial.println(F(" - restarting module."));
+      restart();
+    }
+
+    // power cycle (or soft reset without a power pin) through the BOOTING steps; never blocks
+    void restart() {
+      if (!power.present()) sendAt(F("AT+RST\r\n")); // at the rate the link runs at now
+      powerOff();
+      sysStatus->setEspState(Status::ESPState::BOOTING);
+      bootNegotiate = true;
+      if (power.present()) {
+        enterBoot(BOOT_CYCLE, 200); // off this long, then powered on again
+      } else {
+        sysStatus->counters.espReboots++;
+        enterBoot(BOOT_SETTLE, 500); // module restarting
+      }
+    }
+
+    enum SendKind : uint8_t { SEND_READING, SEND_ALERT };
+    SendKind inFlightKind = SEND_READING;
+    uint16_t inFlightSeq = 0; // seq of the reading carried by pendingPayload
+    bool retryPending = false; // last reading sent has not been acknowledged yet
+    unsigned long inFlightEventTime = 0; // millis of the edge this request reports
+    bool inFlightTimed = false; // inFlightEventTime is on this boot's clock
+    bool alertDelivered = false;
+    unsigned long deliveredAlertTs = 0;
+    uint8_t deliveredAlertCh = 0;
+    uint8_t inFlightChannel = 0; // PIR channel of an alert in flight
+    bool closePending = false;   // AT+CIPCLOSE sent by abandonSend(), reply not seen yet
+    unsigned long closeSentAt = 0;
+
+    // build the GET request around the field list and start the TCP exchange
+    bool startRequest(const char *fields) {
+      bool passthrough = usePassthrough || passthroughOpen;
+      // the request keeps this mode to the end even if usePassthrough is toggled meanwhile
+      requestPassthrough = passthrough;
+      // construct GET request
+      char buffer[REQUEST_LEN];
+      if (!formatRequest(buffer, sizeof(buffer), fields, passthrough)) sysStatus->counters.fieldsTruncated++;
+      delayingForResponse = true;
+      pendingPayload = String(buffer);
+      requestStartTime = millis();
+      requestTxBytes = 0;
+      sysStatus->counters.sendsAttempted++;
+      httpState = HTTP_NONE;
+      sysStatus->setEspState(Status::ESPState::SENDING);
+      if (passthroughOpen) {
+        // link already in data mode: the request goes straight through, reply comes back inline
+        writePayload();
+        pendingSendState = 4;
+      } else if (passthrough) {
+        sendAt(F("AT+CIPMODE=1\r\n"));
+        pendingSendState = 5; // wait for "OK", then CIPSTART
+      } else {
+        // Start TCP connection
+        sendAt(F("AT+CIPSTART=\"TCP\",\"api.thingspeak.com\",80\r\n"));
+        pendingSendState = 1; // next step after CIPSTART is to wait for "OK" then send CIPSEND
+      }
+      return true;
+    }
+
+    // ThingSpeak reply parsing: status line, headers, then body = entry id (0 = rejected)
+    enum HttpState : uint8_t { HTTP_NONE, HTTP_HEADERS, HTTP_BODY, HTTP_DONE };
+    HttpState httpState = HTTP_NONE;
+    int httpStatus = 0;
+    bool httpChunked = false;
+    bool httpChunkSizeSeen = false;
     bool delayingForResponse = false;
-    unsigned long lastAtCheck;
 
     void sendAt(const char *cmd) {
       ss.print(cmd);
+      sentAt(strlen(cmd));
       // also echo to Serial for debugging
-      Serial.print("[ESP CMD] "); Serial.print(cmd);
+      if (Features::commandEcho) { Serial.print(F("[ESP CMD] ")); Serial.print(cmd); }
+    }
+    // fixed commands stay in flash: F("AT...\r\n")
+    void sendAt(const __FlashStringHelper *cmd) {
+      ss.print(cmd);
+      sentAt(strlen_P((const char *)cmd));
+      if (Features::commandEcho) { Serial.print(F("[ESP CMD] ")); Serial.print(cmd); }
+    }
+    void sentAt(size_t n) {
+      lastTxTime = millis();
+      requestTxBytes += n;
+      if (sysStatus) sysStatus->counters.bytesSent += n;
+    }
+
+
+    // payload transmit in slices, see ESP_TX_SLICE_MS
+    uint16_t txOffset = 0;
+    bool txActive = false;
+    unsigned long txSliceMaxUs = 0;
+
+    void writePayload() {
+      if (Features::commandEcho) {
+        Serial.print(F("[ESP CMD] <payload> len="));
+        Serial.println(pendingPayload.length());
+      }
+      txOffset = 0;
+      txActive = true;
+      serviceTx();
     }
 
-    void configureWiFi() {
-      // Basic WiFi connection steps; minimal and synchronous-ish
-      sendAt("AT\r\n");
-      delay(200);
-      sendAt("AT+CWMODE=1\r\n"); // station
-      delay(200);
-      // connect to WiFi (may take a while) - we do it non-blocking by issuing command and waiting for response in loop()
-      String cmd;
-      cmd = String("AT+CWJAP=\"") + WIFI_SSID + "\",\"" + WIFI_PASS + "\"\r\n";
-      sendAt(cmd.c_str());
-      // After successful connection, the ESP will reply with "WIFI CONNECTED" and "OK"
-      // handleResponse() will set state to READY when we detect connection.
+    uint16_t txSliceBytes() const {
+      unsigned long n = ESP_TX_SLICE_MS * linkBaud / 10000UL; // 10 bits per byte
+      return n ? n : 1;
+    }
+
+    void serviceTx() {
+      if (!txActive) return;
+      uint16_t len = pendingPayload.length();
+      if (txOffset >= len) { txActive = false; return; }
+      uint16_t n = len - txOffset;
+      if (n > txSliceBytes()) n = txSliceBytes();
+      unsigned long t0 = micros();
+      ss.write((const uint8_t *)pendingPayload.c_str() + txOffset, n);
+      unsigned long dt = micros() - t0;
+      if (dt > txSliceMaxUs) txSliceMaxUs = dt;
+      txOffset += n;
+      requestTxBytes += n;
+      sysStatus->counters.bytesSent += n;
+      lastTxTime = millis();
+      if (txOffset >= len) txActive = false;
+    }
+
+    // "+++" escape from data mode: 1 s silence, "+++", 1 s silence, then close the link
+    void serviceEscape(unsigned long now) {
+      if (escapeStep == 1 && now - lastTxTime > PASSTHROUGH_GUARD_MS) {
+        ss.print(F("+++"));
+        lastTxTime = now;
+        if (Features::commandEcho) Serial.println(F("[ESP CMD] +++"));
+        escapeStep = 2;
+      } else if (escapeStep == 2 && now - lastTxTime > PASSTHROUGH_GUARD_MS) {
+        passthroughOpen = false;
+        sendAt(F("AT+CIPCLOSE\r\n"));
+        escapeStep = 3;
+      }
+    }
+
+    // Process one line of ThingSpeak's HTTP reply (with any "+IPD,<len>:" prefix removed)
+    void handleHttpLine(const String &line) {
+      if (httpState == HTTP_NONE) {
+        if (!line.startsWith("HTTP/")) return;
+        // "HTTP/1.1 200 OK"
+        int sp = line.indexOf(' ');
+        httpStatus = (sp > 0) ? line.substring(sp + 1).toInt() : 0;
+        httpChunked = false;
+        httpChunkSizeSeen = false;
+        httpState = HTTP_HEADERS;
+        return;
+      }
+      if (httpState == HTTP_HEADERS) {
+        if (line.startsWith("Transfer-Encoding") && line.indexOf("chunked") >= 0) httpChunked = true;
+        return;
+      }
+      if (httpState == HTTP_BODY) {
+        if (httpChunked && !httpChunkSizeSeen) {
+          // first body line is the chunk length (hex), the entry id follows
+          httpChunkSizeSeen = true;
+          return;
+        }
+        // body may run straight into "CLOSED"; toInt() stops at the first non-digit
+        long entryId = line.toInt();
+        httpState = HTTP_DONE;
+        finishSend(httpStatus == 200 && entryId > 0, entryId);
+      }
+    }
+
+    // Close out the in-flight request. Only a positive entry id counts as delivered.
+    void finishSend(bool delivered, long entryId) {
+      replyTime = millis();
+      if (delivered) {
+        unsigned long now = millis();
+        lastRequestTxBytes = requestTxBytes;
+        lastRequestMs = now - requestStartTime;
+        // edge-to-cloud latency; skipped for readings recorded before the last reset
+        bool timed = inFlightTimed && inFlightEventTime <= now;
+        unsigned long latency = timed ? now - inFlightEventTime : 0;
+        if (inFlightKind == SEND_ALERT) {
+          Serial.print(F("[ESP] ThingSpeak entry ")); Serial.print(entryId);
+          Serial.println(F(" for motion alert"));
+          alertDelivered = true;
+          deliveredAlertTs = inFlightEventTime;
+          deliveredAlertCh = inFlightChannel;
+          if (sysStatus) {
+            sysStatus->lastAlertLatencyMs = latency;
+            sysStatus->counters.sendsOk++;
+            sysStatus->lastSendOk = true;
+            sysStatus->lastSendSuccessTime = now;
+          }
+          pendingPayload = "";
+          pendingSendState = 0;
+          httpState = HTTP_NONE;
+          sysStatus->setEspState(Status::ESPState::READY);
+          return;
+        }
+        Serial.print(F("[ESP] ThingSpeak entry ")); Serial.print(entryId);
+        Serial.print(F(" for seq=")); Serial.println(inFlightSeq);
+        retryPending = false;
+        if (sysStatus) {
+          sysStatus->counters.sendsOk++;
+          if (timed) {
+            sysStatus->lastEventLatencyMs = latency;
+            sysStatus->eventLatency.add(latency);
+            if (latency > sysStatus->counters.maxEventToUploadMs) sysStatus->counters.maxEventToUploadMs = latency;
+          }
+        }
+        EEPROMStorage::Reading next;
+        // only advance if the next unsent reading is still the one we sent (guards against a stale ack)
+        if (storage && storage->peekNext(EEPROMStorage::CURSOR_CLOUD, next) && next.seq == inFlightSeq) {
+          storage->advance(EEPROMStorage::CURSOR_CLOUD, 1);
+          if (sysStatus) {
+            sysStatus->storedReadingsCount = storage->size();
+            sysStatus->lastSendOk = true;
+            sysStatus->lastSendSuccessTime = millis();
+          }
+        }
+      } else {
+        Serial.print(F("[ESP] Update not stored by ThingSpeak (status "));
+        Serial.print(httpStatus); Serial.println(F(") - will retry."));
+        if (sysStatus) {
+          sysStatus->lastSendOk = false;
+          sysStatus->counters.sendsFailed++;
+        }
+      }
+      pendingPayload = "";
+      pendingSendState = 0;
+      httpState = HTTP_NONE;
+      sysStatus->setEspState(Status::ESPState::READY);
     }
 
     // Process one received line from ESP
     void handleResponse(const String &line) {
+      if (bootStep != BOOT_IDLE && handleBootLine(line)) return;
+
+      // in data mode everything from the ESP is the server's reply, without +IPD framing,
+      // until the server closes the link: the ESP then says "CLOSED" and leaves data mode
+      if (passthroughOpen) {
+        if (pendingSendState == 4 && !line.equals("CLOSED")) handleHttpLine(line);
+        if (line.indexOf("CLOSED") < 0) return;
+        passthroughOpen = false;
+        escapeStep = 0;
+        if (pendingSendState == 4) {
+          Serial.println(F("[ESP] Connection closed without entry id - will retry."));
+          if (sysStatus) {
+            sysStatus->lastSendOk = false;
+            sysStatus->counters.sendsFailed++;
+          }
+        }
+        txActive = false;
+        pendingPayload = "";
+        pendingSendState = 0;
+        httpState = HTTP_NONE;
+        sendAt(F("AT+CIPMODE=0\r\n")); // normal mode again; the next request picks its own
+        Serial.println(F("[ESP] Pass-through link closed by the server."));
+        sysStatus->setEspState(Status::ESPState::READY);
+        return;
+      }
+
+      // reply to the AT+CIPCLOSE of an abandoned send. "ERROR" only means the link was already
+      // closed; none of it belongs to a request started since (AT replies come in order)
+      if (closePending) {
+        if (line.equals("OK") || line.indexOf("ERROR") >= 0) {
+          closePending = false;
+          return;
+        }
+        if (line.indexOf("CLOSED") >= 0) return;
+      }
+
+      // back in command mode after "+++": close, then return to normal CIPSEND handling
+      if (escapeStep == 3 && (line.indexOf("OK") >= 0 || line.indexOf("CLOSED") >= 0 || line.indexOf("ERROR") >= 0)) {
+        sendAt(F("AT+CIPMODE=0\r\n"));
+        escapeStep = 0;
+        Serial.println(F("[ESP] Pass-through link closed."));
+        sysStatus->setEspState(Status::ESPState::READY);
+        return;
+      }
+
+      // CIPMODE=1 accepted: open the connection
+      if (pendingSendState == 5 && line.equals("OK")) {
+        sendAt(F("AT+CIPSTART=\"TCP\",\"api.thingspeak.com\",80\r\n"));
+        pendingSendState = 1;
+        return;
+      }
+
+      // ThingSpeak's reply arrives as "+IPD,<len>:<data>"; continuation lines have no prefix
+      if (pendingSendState >= 3 && (line.startsWith("+IPD,") || (pendingSendState == 4 && httpState != HTTP_NONE))) {
+        int colon = line.startsWith("+IPD,") ? line.indexOf(':') : -1;
+        String data = (colon >= 0) ? line.substring(colon + 1) : line;
+        if (httpState != HTTP_DONE && data.length()) handleHttpLine(data);
+        if (line.indexOf("CLOSED") < 0) return;
+      }
+
       // common responses: OK, ERROR, WIFI CONNECTED, WIFI GOT IP, SEND OK, > (prompt), CONNECT, CLOSED
       if (line.indexOf("OK") >= 0 && sysStatus->espState == Status::ESPState::BOOTING) {
         // simple heuristic: treat OK after setup as indication everything's fine
         // but wait for "WIFI GOT IP" ideally
       }
       if (line.indexOf("WIFI GOT IP") >= 0) {
-        sysStatus->espState = Status::ESPState::READY;
-        Serial.println("[ESP] WiFi connected, READY.");
+        bootStep = BOOT_IDLE;
+        sysStatus->setEspState(Status::ESPState::READY);
+        Serial.println(F("[ESP] WiFi connected, READY."));
       }
       if (line.indexOf("WIFI CONNECTED") >= 0) {
         // waiting for GOT IP
       }
       if (line.indexOf("ERROR") >= 0) {
-        sysStatus->espState = Status::ESPState::ERROR;
+        sysStatus->setEspState(Status::ESPState::ERROR);
       }
       if (line.indexOf("DNS FAIL") >= 0) {
-        sysStatus->espState = Status::ESPState::ERROR;
+        sysStatus->setEspState(Status::ESPState::ERROR);
       }
 
       // Sent when AT+CIPSTART succeeds: "OK" then "CONNECT" or "ALREADY CONNECT"
       if ((line.indexOf("CONNECT") >= 0 || line.indexOf("ALREADY CONNECT") >= 0) && pendingSendState == 1) {
+        if (requestPassthrough) {
+          // pass-through: plain CIPSEND switches the link into data mode
+          sendAt(F("AT+CIPSEND\r\n"));
+          pendingSendState = 2;
+          return;
+        }
         // Now send CIPSEND with payload length
         int len = pendingPayload.length();
         char tmp[40];
-        snprintf(tmp, sizeof(tmp), "AT+CIPSEND=%d\r\n", len);
+        snprintf_P(tmp, sizeof(tmp), PSTR("AT+CIPSEND=%d\r\n"), len);
         sendAt(tmp);
         pendingSendState = 2;
         return;
@@ -184,9 +951,13 @@ class ESP01Driver {
       // ESP shows '>' when ready to accept payload
       if (line.endsWith(">") && pendingSendState == 2) {
         // send payload
-        ss.print(pendingPayload);
-        Serial.print("[ESP CMD] <payload sent> len=");
-        Serial.println(pendingPayload.length());
+        if (requestPassthrough) {
+          passthroughOpen = true;
+          writePayload();
+          pendingSendState = 4; // no SEND OK in data mode, the reply follows directly
+          return;
+        }
+        writePayload();
         pendingSendState = 3; // waiting for SEND OK
         return;
       }
@@ -194,36 +965,41 @@ class ESP01Driver {
       // confirm that payload was sent
       if (line.indexOf("SEND OK") >= 0 || line.indexOf("SEND FAIL") >= 0) {
         if (line.indexOf("SEND OK") >= 0) {
-          Serial.println("[ESP] SEND OK - marking reading as sent.");
-          // On success, remove oldest from EEPROM storage
-          if (storage && storage->hasPending()) {
-            storage->popOldest();
-            if (sysStatus) {
-              sysStatus->storedReadingsCount = storage->size();
-              sysStatus->lastSendOk = true;
-              sysStatus->lastSendSuccessTime = millis();
-            }
-          }
-          // after send, close TCP (it was connection: close; connection closes when remote closes)
-        } else {
-          Serial.println("[ESP] SEND FAIL");
-          if (sysStatus) sysStatus->lastSendOk = false;
+          // bytes left the ESP; the reading stays queued until ThingSpeak returns an entry id
+          Serial.println(F("[ESP] SEND OK - awaiting ThingSpeak entry id."));
+          if (pendingSendState == 3) pendingSendState = 4;
+          return;
+        }
+        Serial.println(F("[ESP] SEND FAIL"));
+        if (sysStatus) {
+          sysStatus->lastSendOk = false;
+          sysStatus->counters.sendsFailed++;
         }
         // clear pending
         pendingPayload = "";
         pendingSendState = 0;
-        sysStatus->espState = Status::ESPState::READY;
+        sysStatus->setEspState(Status::ESPState::READY);
         return;
       }
 
-      // When remote closes connection - we can treat it as send complete if not already handled
+      // When remote closes connection - if no entry id arrived the reading stays queued
       if (line.indexOf("CLOSED") >= 0) {
-        // clear pending just in case
+        if (pendingSendState >= 3 && httpState != HTTP_DONE) {
+          Serial.println(F("[ESP] Connection closed without entry id - will retry."));
+          if (sysStatus) {
+            sysStatus->lastSendOk = false;
+            sysStatus->counters.sendsFailed++;
+          }
+        }
         pendingPayload = "";
         pendingSendState = 0;
-        sysStatus->espState = Status::ESPState::READY;
+        httpState = HTTP_NONE;
+        sysStatus->setEspState(Status::ESPState::READY);
       }
     }
 };
 
+// runtime power pin, full debug output
+typedef ESP01DriverT<> ESP01Driver;
+
 #endif
@@ -0,0 +1,58 @@
+// FastPin.h
+// Compile-time pin access for the Uno (ATmega328P): the pin number is a template argument, so
+// reads and writes become single PINx/PORTx instructions instead of digitalRead/digitalWrite
+// table lookups.
+// - AvrPortB/C/D: whole-port access (used by PortMotionDetector for several pins at once)
+// - FastPin<PIN>: Arduino pin number -> port + bit mask (0..7 = PORTD, 8..13 = PORTB, 14..19 = PORTC)
+
+#ifndef FAST_PIN_H
+#define FAST_PIN_H
+
+#include <Arduino.h>
+
+struct AvrPortB {
+  static uint8_t read() { return PINB; }
+  static void makeInputs(uint8_t mask) { DDRB &= ~mask; PORTB &= ~mask; }
+  static void makeOutputs(uint8_t mask) { DDRB |= mask; }
+  static void write(uint8_t mask, bool high) { if (high) PORTB |= mask; else PORTB &= ~mask; }
+};
+struct AvrPortC {
+  static uint8_t read() { return PINC; }
+  static void makeInputs(uint8_t mask) { DDRC &= ~mask; PORTC &= ~mask; }
+  static void makeOutputs(uint8_t mask) { DDRC |= mask; }
+  static void write(uint8_t mask, bool high) { if (high) PORTC |= mask; else PORTC &= ~mask; }
+};
+struct AvrPortD {
+  static uint8_t read() { return PIND; }
+  static void makeInputs(uint8_t mask) { DDRD &= ~mask; PORTD &= ~mask; }
+  static void makeOutputs(uint8_t mask) { DDRD |= mask; }
+  static void write(uint8_t mask, bool high) { if (high) PORTD |= mask; else PORTD &= ~mask; }
+};
+
+template<uint8_t PIN, bool = (PIN < 8), bool = (PIN < 14)>
+struct FastPinMap;
+template<uint8_t PIN> struct FastPinMap<PIN, true, true> {
+  typedef AvrPortD Port;
+  static const uint8_t MASK = 1 << PIN;
+};
+template<uint8_t PIN> struct FastPinMap<PIN, false, true> {
+  typedef AvrPortB Port;
+  static const uint8_t MASK = 1 << (PIN - 8);
+};
+template<uint8_t PIN> struct FastPinMap<PIN, false, false> {
+  static_assert(PIN < 20, "Uno digital pins are 0..19");
+  typedef AvrPortC Port;
+  static const uint8_t MASK = 1 << (PIN - 14);
+};
+
+template<uint8_t PIN>
+struct FastPin : FastPinMap<PIN> {
+  typedef typename FastPinMap<PIN>::Port Port;
+  static const uint8_t MASK = FastPinMap<PIN>::MASK;
+  static bool read() { return Port::read() & MASK; }
+  static void makeInput() { Port::makeInputs(MASK); }
+  static void makeOutput() { Port::makeOutputs(MASK); }
+  static void write(bool high) { Port::write(MASK, high); }
+};
+
+#endif
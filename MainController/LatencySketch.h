@@ -0,0 +1,92 @@
+// LatencySketch.h
+// Fixed-size latency summary: count, min, max, running average and a log-scale histogram
+// for quantiles (p50/p95). Values are milliseconds.
+// - bucket 0 holds < 64 ms; above that every power of two is split into 2 buckets,
+//   so a quantile is off by at most ~1/3 of its value; the last bucket is open-ended (> ~6 days)
+// - bucket counts are uint8_t; when one saturates all are halved, which keeps the shape and
+//   slowly ages out old samples. 48 buckets = 48 bytes of SRAM.
+
+#ifndef LATENCY_SKETCH_H
+#define LATENCY_SKETCH_H
+
+#include <Arduino.h>
+
+struct LatencySketch {
+  static const uint8_t BUCKETS = 48;
+
+  uint16_t count;
+  unsigned long minMs;
+  unsigned long maxMs;
+  unsigned long sumMs;    // with sumCount: running average, halved together before overflow
+  uint16_t sumCount;
+  uint8_t hist[BUCKETS];
+
+  void init() {
+    count = 0;
+    minMs = 0;
+    maxMs = 0;
+    sumMs = 0;
+    sumCount = 0;
+    memset(hist, 0, sizeof(hist));
+  }
+
+  void add(unsigned long ms) {
+    if (!count || ms < minMs) minMs = ms;
+    if (ms > maxMs) maxMs = ms;
+    if (count < 0xFFFF) ++count;
+    while (sumMs + ms < sumMs || sumCount == 0xFFFF) { sumMs /= 2; sumCount /= 2; }
+    sumMs += ms;
+    ++sumCount;
+    uint8_t b = bucketOf(ms);
+    if (hist[b] == 0xFF) {
+      for (uint8_t i = 0; i < BUCKETS; ++i) hist[i] = (hist[i] + 1) / 2;
+    }
+    ++hist[b];
+  }
+
+  unsigned long avgMs() const { return sumCount ? sumMs / sumCount : 0; }
+
+  // upper edge of the bucket holding the q-th percentile (0 if empty)
+  unsigned long quantileMs(uint8_t q) const {
+    unsigned long total = 0;
+    for (uint8_t i = 0; i < BUCKETS; ++i) total += hist[i];
+    if (!total) return 0;
+    unsigned long target = (total * q + 99) / 100;
+    unsigned long seen = 0;
+    for (uint8_t i = 0; i < BUCKETS; ++i) {
+      seen += hist[i];
+      if (seen >= target) {
+        unsigned long upper = bucketUpper(i);
+        return upper > maxMs ? maxMs : upper;
+      }
+    }
+    return maxMs;
+  }
+
+  void print(Print &out) const {
+    out.print(F("n: ")); out.print(count);
+    out.print(F("  min: ")); out.print(minMs);
+    out.print(F("  avg: ")); out.print(avgMs());
+    out.print(F("  p50: ")); out.print(quantileMs(50));
+    out.print(F("  p95: ")); out.print(quantileMs(95));
+    out.print(F("  max: ")); out.print(maxMs);
+    out.println(F(" (ms)"));
+  }
+
+  static uint8_t bucketOf(unsigned long ms) {
+    if (ms < 64) return 0;
+    uint8_t msb = sizeof(ms) * 8 - 1 - __builtin_clzl(ms);
+    uint8_t b = 1 + (msb - 6) * 2 + ((ms >> (msb - 1)) & 1);
+    return b < BUCKETS ? b : BUCKETS - 1;
+  }
+
+  static unsigned long bucketUpper(uint8_t b) {
+    if (b == 0) return 64;
+    if (b == BUCKETS - 1) return 0xFFFFFFFFUL;
+    uint8_t msb = 6 + (b - 1) / 2;
+    unsigned long lower = (1UL << msb) + ((b - 1) % 2) * (1UL << (msb - 1));
+    return lower + (1UL << (msb - 1));
+  }
+};
+
+#endif
@@ -1,78 +1,399 @@
 // MainController.ino
 // Top-level sketch for IoT Motion Logger
 // - Coordinates PIR detection, EEPROM ring buffer (overwrite), ESP01 sender, status and serial UI
-// - Stores durations in seconds and persistent eventCounter per entry
+// - Each stored reading is a 12-byte record (see EEPROMStorage.h): duration and start
+//   timestamp in ms, persistent sequence number, flags, PIR channel and merged pulse count
 
 #include <Arduino.h>
+#include <avr/wdt.h>
 #include "MotionDetector.h"
 #include "ESP01Driver.h"
 #include "Status.h"
 #include "EEPROMStorage.h"
+#include "OccupancyStats.h"
+#include "SerialExport.h"
+#include "BinaryLink.h"
+#include "Bench.h"
 
 // --- Configuration ---
 const uint8_t PIR_PIN = 2;        // PIR input (HC-SR501 OUT)
-const uint8_t ESP_POWER_PIN = 8;  // control CH_PD/EN through level shifter / transistor (set to -1 if not used)
+const int8_t ESP_POWER_PIN = 8;   // control CH_PD/EN through level shifter / transistor (set to -1 if not used)
+const bool SERIAL_UI = true;      // false compiles out the serial command interface
+const unsigned long PIR_WARMUP_MS = 120000UL;         // HC-SR501 settle time after power-up
+const bool PIR_WARMUP_TAG = false;                     // true: keep warm-up events, tagged; false: drop them
+const bool ESP_AUTO_ON = false;                        // power the ESP in setup() so Wi-Fi join overlaps PIR warm-up
 const unsigned long THINGSPEAK_MIN_INTERVAL = 20000UL; // 20 seconds between ThingSpeak updates
+const unsigned long ALERT_MIN_INTERVAL = 15000UL;      // motion alerts only wait for ThingSpeak's own 15 s limit,
+                                                       // timed from its last reply as well as our last request
+const unsigned long ALERT_DEBOUNCE_MS = 0;             // motion must last this long before an alert is raised
+const unsigned long MERGE_GAP_MS = 5000UL;             // retrigger within this gap extends the event (0 = off)
+const unsigned long CHECKPOINT_INTERVAL_MS = 60000UL;  // in-progress record for ongoing motion (0 = off)
+const bool UPLOAD_STATS = true;                        // add occupancy summary (field7/field8) to each upload
+const bool UPLOAD_HEALTH = true;                       // add key counters as ThingSpeak's status text to each upload
+const bool EXPORT_BLOCKING = false;                    // true: readings are kept until exported as well as uploaded
+const bool LOOP_WATCHDOG = true;                       // AVR watchdog resets the board if loop() stops completing for 8 s
 
 // Serial options
 const unsigned long SERIAL_BAUD = 115200;
 
 // Instances (singletons used across files)
-MotionDetector motion(PIR_PIN);
-ESP01Driver esp(10 /*RX to ESP TX*/, 11 /*TX to ESP RX*/, ESP_POWER_PIN);
+// Pins are template arguments so sampling and power control compile to direct port access.
+// (several PIR zones on one port: PortMotionDetector<AvrPortD, _BV(2) | _BV(3)> motion;
+//  quiet ESP driver: ESP01DriverT<FixedPowerPin<ESP_POWER_PIN>, EspQuietFeatures> esp(10, 11);)
+PinMotionDetector<PIR_PIN> motion;
+ESP01DriverT<FixedPowerPin<ESP_POWER_PIN>> esp(10 /*RX to ESP TX*/, 11 /*TX to ESP RX*/);
 EEPROMStorage eepromStorage; // manages circular buffer with overwrite + persistent event counter
 Status sysStatus; // shared status
+OccupancyStats occupancy; // rolling occupancy statistics
+BinaryLink binaryLink; // framed binary protocol next to the text UI (tools/motionlink.py)
 
 // For user toggles
 bool showEspRaw = false;
 unsigned long lastThingSpeakSendTime = 0;
+uint16_t linkEventSeq = 0;      // nextSequence() at the last publish: lower seqs are published
+uint8_t linkAlertSent = 0;      // channels whose pending motion alert is already published
+unsigned long linkAlertTs[decltype(motion)::channels];
+
+// Reset cause, saved before main(): the watchdog stays armed across its own reset
+// and must be switched off before setup()'s delays run into it. Optiboot clears MCUSR
+// before it starts the sketch and passes the flags in r2, which only .init0 sees intact.
+// Without Optiboot (ISP upload, another bootloader) r2 is left over from before the reset,
+// so it is only believed when MCUSR is empty and it holds nothing but reset flag bits.
+// Both live in .noinit: .init3 runs before .bss is cleared.
+uint8_t resetFlags __attribute__((section(".noinit")));
+uint8_t bootloaderFlags __attribute__((section(".noinit")));
+void captureBootloaderFlags() __attribute__((naked, used, section(".init0")));
+void captureBootloaderFlags() {
+  asm volatile("sts %0, r2" : "=m"(bootloaderFlags)); // r1 is not zeroed yet: no C code here
+}
+void captureResetFlags() __attribute__((naked, used, section(".init3")));
+void captureResetFlags() {
+  const uint8_t valid = _BV(WDRF) | _BV(BORF) | _BV(EXTRF) | _BV(PORF);
+  resetFlags = MCUSR & valid;
+  if (!resetFlags && !(bootloaderFlags & ~valid)) resetFlags = bootloaderFlags;
+  MCUSR = 0;
+  wdt_disable();
+}
+
+// serial command match with the name kept in flash: isCommand(cmd, PSTR("esp on"))
+bool isCommand(const String &cmd, PGM_P name) {
+  return strcasecmp_P(cmd.c_str(), name) == 0;
+}
 
 // helper: print user section header
 void printUserHeader() {
-  Serial.print("(USER) ");
+  Serial.print(F("(USER) "));
 }
 
-// Process incoming serial commands from the user
+// Answer one binary request (see BinaryLink.h for the message layouts)
+void handleLinkMessage(const LinkMessage &req) {
+  LinkMessage rsp;
+  rsp.begin(req.type() | BinaryLink::MSG_REPLY, req.tag());
+  switch (req.type()) {
+    case BinaryLink::MSG_PING:
+      rsp.u8(BinaryLink::VERSION);
+      rsp.u32(millis());
+      break;
+    case BinaryLink::MSG_GET_STATUS:
+      rsp.u32(millis());
+      rsp.u8((uint8_t)sysStatus.espState);
+      rsp.u8((uint8_t)sysStatus.pirState);
+      rsp.u8(eepromStorage.size());
+      rsp.u8(eepromStorage.pending(EEPROMStorage::CURSOR_CLOUD));
+      rsp.u8(eepromStorage.pending(EEPROMStorage::CURSOR_EXPORT));
+      rsp.u8(sysStatus.lastSendOk);
+      rsp.u32(sysStatus.lastSendSuccessTime);
+      rsp.u32(sysStatus.lastAlertLatencyMs);
+      rsp.u32(sysStatus.lastEventLatencyMs);
+      rsp.u32(sysStatus.espStateSince);
+      rsp.u16(sysStatus.eventLatency.count);
+      rsp.u32(sysStatus.eventLatency.quantileMs(95));
+      break;
+    case BinaryLink::MSG_GET_COUNTERS: {
+      const Status::Counters &c = sysStatus.counters;
+      rsp.u16(c.sendsAttempted);
+      rsp.u16(c.sendsOk);
+      rsp.u16(c.sendsFailed);
+      rsp.u16(c.retries);
+      rsp.u32(c.bytesSent);
+      rsp.u16(c.eepromWrites);
+      rsp.u8(c.queueHighWater);
+      rsp.u16(c.espReboots);
+      rsp.u32(c.maxEventToUploadMs);
+      rsp.u16(c.rxOverflows);
+      rsp.u16(c.rxTruncatedLines);
+      rsp.u16(c.espRecoveries);
+      rsp.u8(c.watchdogResets);
+      rsp.u32(c.rxBytes);
+      rsp.u16(c.fieldsTruncated);
+      rsp.u32(c.eepromReads);
+      rsp.u32(c.eepromReadBytes);
+      rsp.u16(c.readingsDrained);
+      break;
+    }
+    case BinaryLink::MSG_COMMAND: {
+      uint8_t cmd = req.argLen() ? req.args()[0] : 0;
+      bool ok = true;
+      switch (cmd) {
+        case BinaryLink::CMD_SEND_NOW: esp.requestImmediateSend = true; break;
+        case BinaryLink::CMD_ESP_ON: esp.powerOn(); break;
+        case BinaryLink::CMD_ESP_OFF: esp.powerOff(); break;
+        case BinaryLink::CMD_SUBSCRIBE:
+          binaryLink.setSubscribed(true);
+          linkEventSeq = eepromStorage.nextSequence();
+          linkAlertSent = 0;
+          break;
+        case BinaryLink::CMD_UNSUBSCRIBE: binaryLink.setSubscribed(false); break;
+        default: ok = false;
+      }
+      rsp.u8(cmd);
+      rsp.u8(ok);
+      break;
+    }
+    default:
+      rsp.begin(BinaryLink::MSG_NAK, req.tag());
+      rsp.u8(req.type());
+  }
+  if (!binaryLink.send(Serial, rsp)) {
+    // reply outgrew LinkMessage::MAX_LEN: a NAK rather than a truncated frame
+    rsp.begin(BinaryLink::MSG_NAK, req.tag());
+    rsp.u8(req.type());
+    binaryLink.send(Serial, rsp);
+  }
+}
+
+// live events for a subscribed host: each newly stored reading and each motion alert
+void publishLinkEvents() {
+  LinkMessage ev;
+  uint16_t next = eepromStorage.nextSequence();
+  if (next != linkEventSeq) {
+    // every reading stored or rewritten since the last pass: seq in [linkEventSeq, next). A
+    // rewritten checkpoint keeps its slot, so the whole ring is walked, not just its tail
+    const uint8_t chunk = 4;
+    EEPROMStorage::Reading batch[chunk];
+    uint8_t n = eepromStorage.size();
+    for (uint8_t i = 0; i < n; i += chunk) {
+      uint8_t got = eepromStorage.peekRange(i, chunk, batch);
+      for (uint8_t j = 0; j < got; ++j) {
+        const EEPROMStorage::Reading &r = batch[j];
+        if ((uint16_t)(r.seq - linkEventSeq) >= (uint16_t)(next - linkEventSeq)) continue;
+        ev.begin(BinaryLink::MSG_EVENT_READING, 0);
+        ev.u32(r.duration_ms);
+        ev.u32(r.ts);
+        ev.u16(r.seq);
+        ev.u8(r.flags);
+        ev.u8(r.channel);
+        ev.u8(r.subEvents);
+        binaryLink.send(Serial, ev);
+      }
+    }
+    linkEventSeq = next;
+  }
+  uint8_t alerts = motion.alertChannels();
+  linkAlertSent &= alerts;
+  for (uint8_t c = 0; alerts; ++c, alerts >>= 1) {
+    if (!(alerts & 1) || ((linkAlertSent >> c) & 1 && motion.alertTime(c) == linkAlertTs[c])) continue;
+    linkAlertSent |= 1 << c;
+    linkAlertTs[c] = motion.alertTime(c);
+    ev.begin(BinaryLink::MSG_EVENT_ALERT, 0);
+    ev.u32(linkAlertTs[c]);
+    ev.u8(c);
+    binaryLink.send(Serial, ev);
+  }
+}
+
+void processSerialCommands();
+
+// "bench": time the per-loop and per-upload hot paths (see Bench.h). Cases marked "(live)" call
+// the running objects and time whatever state they are in (link up or down, PIR high or low), so
+// compare them only between runs in the same state. Storage cases only read EEPROM; the ESP reply
+// parser runs on an offline driver so the live link state is untouched. Each group is its own
+// block so the stack only holds one group's objects, and the upload cases share one buffer.
+void runBenchmarks() {
+  Bench bench(Serial);
+  EEPROMStorage::Reading r = { 4200, 123456UL, 42, 0, 1, 0 };
+
+  // once per loop()
+  bench.run(F("serial idle (live)"), 1000, [] { processSerialCommands(); });
+  bench.run(F("pir sample (live)"), 1000, [] { motion.loop(); });
+  bench.run(F("esp loop (live)"), 200, [] { esp.loop(false); });
+
+  {
+    // PIR sampling through the runtime pin (digitalRead) and the compile-time pin (one PINx read),
+    // both on detectors without storage so neither stores events
+    MotionDetector runtimePir(PIR_PIN);
+    runtimePir.begin();
+    PinMotionDetector<PIR_PIN> fixedPir;
+    fixedPir.begin();
+    bench.run(F("pir digitalRead"), 1000, [&] { runtimePir.loop(); });
+    bench.run(F("pir FastPin"), 1000, [&] { fixedPir.loop(); });
+  }
+
+  {
+    // storage and the record codec
+    EEPROMStorage::Reading batch[4];
+    uint8_t raw[EEPROMStorage::READING_BYTES];
+    bench.run(F("peekNext cloud"), 200, [&] { eepromStorage.peekNext(EEPROMStorage::CURSOR_CLOUD, r); });
+    bench.run(F("peekRange 4"), 200, [&] { eepromStorage.peekRange(0, 4, batch); });
+    bench.run(F("query all"), 100, [] { eepromStorage.queryByEndTime(0, 0xFFFFFFFFUL, true); });
+    bench.run(F("encodeReading"), 1000, [&] { EEPROMStorage::encodeReading(r, raw); });
+    bench.run(F("decodeReading"), 1000, [&] { EEPROMStorage::decodeReading(raw, r); });
+  }
+
+  {
+    // ESP replies, one case per line type (none of these send or print from an idle driver)
+    Status offlineStatus;
+    offlineStatus.init();
+    decltype(esp) offline(10, 11); // same type as esp: no second copy of the driver in flash
+    offline.attach(&offlineStatus, nullptr);
+    String line(F("OK"));
+    bench.run(F("esp line OK"), 200, [&] { offline.injectLine(line); });
+    line = F("CLOSED");
+    bench.run(F("esp line CLOSED"), 200, [&] { offline.injectLine(line); });
+    line = F("+IPD,104:HTTP/1.1 200 OK");
+    bench.run(F("esp line +IPD"), 200, [&] { offline.injectLine(line); });
+    line = F("Content-Type: text/plain; charset=utf-8");
+    bench.run(F("esp line other"), 200, [&] { offline.injectLine(line); });
+  }
+
+  {
+    // one upload: summary fields, field list and GET request as loop()/sendReadingToThingSpeak
+    // build them. The field list goes at the front of buf and the request after it; the summary
+    // borrows the request's space, which is only written once the field list is done with it
+    char buf[decltype(esp)::FIELDS_LEN + decltype(esp)::REQUEST_LEN];
+    char *fields = buf;
+    char *request = buf + decltype(esp)::FIELDS_LEN;
+    char *summary = request;
+    const size_t summaryLen = ESP_EXTRA_FIELDS_MAX + 1;
+    bench.run(F("upload summary"), 100, [&] {
+      occupancy.formatFields(summary, summaryLen, millis());
+      size_t n = strlen(summary);
+      if (n) summary[n++] = '&';
+      sysStatus.formatHealth(summary + n, summaryLen - n);
+    });
+    bench.run(F("format fields"), 100, [&] {
+      decltype(esp)::formatReadingFields(fields, decltype(esp)::FIELDS_LEN, r, summary);
+    });
+    bench.run(F("format request"), 100, [&] {
+      decltype(esp)::formatRequest(request, decltype(esp)::REQUEST_LEN, fields, false);
+    });
+    String payload;
+    bench.run(F("payload String"), 100, [&] { payload = request; });
+  }
+
+  {
+    // event bookkeeping and the binary link
+    Bench::NullPrint sink;
+    LatencySketch sketch = sysStatus.eventLatency;
+    bench.run(F("latency add"), 1000, [&] { sketch.add(1234); });
+    LinkMessage ev;
+    ev.begin(BinaryLink::MSG_EVENT_READING, 0);
+    ev.u32(r.duration_ms); ev.u32(r.ts); ev.u16(r.seq); ev.u8(r.flags); ev.u8(r.channel); ev.u8(r.subEvents);
+    bench.run(F("link frame"), 200, [&] { binaryLink.send(sink, ev); });
+  }
+}
+
+// Process incoming serial commands from the user (or binary frames, which start with 0x00)
 void processSerialCommands() {
-  if (!Serial.available()) return;
+  if (!SERIAL_UI) return;
+  LinkMessage req;
+  if (binaryLink.poll(Serial, req)) {
+    handleLinkMessage(req);
+    return;
+  }
+  if (binaryLink.busy() || !Serial.available()) return;
   String cmd = Serial.readStringUntil('\n');
   cmd.trim();
 
   printUserHeader();
 
-  if (cmd.equalsIgnoreCase("esp on")) {
-    Serial.println("ESP ON");
+  if (isCommand(cmd, PSTR("esp on"))) {
+    Serial.println(F("ESP ON"));
     esp.powerOn();
   }
-  else if (cmd.equalsIgnoreCase("esp off")) {
-    Serial.println("ESP OFF (graceful)");
+  else if (isCommand(cmd, PSTR("esp off"))) {
+    Serial.println(F("ESP OFF (graceful)"));
     esp.powerOff(); // will request graceful disconnect then cut power
   }
-  else if (cmd.equalsIgnoreCase("send")) {
-    Serial.println("Force send (if ESP READY)");
+  else if (isCommand(cmd, PSTR("esp"))) {
+    esp.printSummary(Serial);
+    Serial.println();
+  }
+  else if (isCommand(cmd, PSTR("pir"))) {
+    motion.printSummary(Serial);
+    Serial.println();
+  }
+  else if (isCommand(cmd, PSTR("stats"))) {
+    occupancy.print(Serial, millis());
+  }
+  else if (isCommand(cmd, PSTR("latency"))) {
+    Serial.print(F("Event-to-upload "));
+    sysStatus.eventLatency.print(Serial);
+  }
+  else if (isCommand(cmd, PSTR("send"))) {
+    Serial.println(F("Force send (if ESP READY)"));
     esp.requestImmediateSend = true;
   }
-  else if (cmd.equalsIgnoreCase("status")) {
+  else if (isCommand(cmd, PSTR("status"))) {
     sysStatus.print(Serial);
   }
-  else if (cmd.equalsIgnoreCase("dump") || cmd.equalsIgnoreCase("show")) {
+  else if (isCommand(cmd, PSTR("status all"))) {
+    sysStatus.print(Serial, true);
+  }
+  else if (strncasecmp_P(cmd.c_str(), PSTR("query "), 6) == 0) {
+    // query <from_s> <to_s> [list] [scan]: readings of this boot that ended in [from, to), seconds
+    // since boot. scan reads every record instead of searching, to compare probes and time
+    String lc = cmd;
+    lc.toLowerCase();
+    int sp1 = lc.indexOf(' ');
+    int sp2 = lc.indexOf(' ', sp1 + 1);
+    unsigned long fromMs = (unsigned long)lc.substring(sp1 + 1).toInt() * 1000UL;
+    bool hasTo = sp2 > 0 && isDigit(lc.charAt(sp2 + 1));
+    unsigned long toMs = hasTo ? (unsigned long)lc.substring(sp2 + 1).toInt() * 1000UL : millis() + 1;
+    bool list = strstr_P(lc.c_str(), PSTR(" list")) != nullptr;
+    bool scan = strstr_P(lc.c_str(), PSTR(" scan")) != nullptr;
+    unsigned long t0 = micros();
+    EEPROMStorage::Query q = scan ? eepromStorage.scanByEndTime(fromMs, toMs)
+                                  : eepromStorage.queryByEndTime(fromMs, toMs, true);
+    unsigned long us = micros() - t0;
+    Serial.print(F("Events: ")); Serial.print(q.n);
+    Serial.print(F("  total(ms): ")); Serial.print(q.totalMs);
+    Serial.print(F("  (probes: ")); Serial.print(q.probes);
+    Serial.print(F(", ")); Serial.print(us); Serial.println(F(" us)"));
+    if (list) eepromStorage.printQuery(Serial, q, fromMs, toMs);
+  }
+  else if (isCommand(cmd, PSTR("export")) || isCommand(cmd, PSTR("export all"))) {
+    // binary frames, see SerialExport.h / tools/export_decode.py
+    SerialExport::run(Serial, eepromStorage, cmd.length() > 6);
+  }
+  else if (isCommand(cmd, PSTR("bench"))) {
+    runBenchmarks();
+  }
+  else if (isCommand(cmd, PSTR("dump")) || isCommand(cmd, PSTR("show"))) {
     eepromStorage.printAll(Serial);
   }
-  else if (cmd.equalsIgnoreCase("clear")) {
-    Serial.println("Clearing EEPROM storage (header + readings)...");
+  else if (isCommand(cmd, PSTR("clear"))) {
+    Serial.println(F("Clearing EEPROM storage (header + readings)..."));
     eepromStorage.clearAll(); // implemented in EEPROMStorage.h
     sysStatus.storedReadingsCount = eepromStorage.size();
-    Serial.println("EEPROM cleared.");
+    Serial.println(F("EEPROM cleared."));
   }
-  else if (cmd.equalsIgnoreCase("toggle_esp_raw")) {
+  else if (isCommand(cmd, PSTR("toggle_esp_raw"))) {
     showEspRaw = !showEspRaw;
-    Serial.print("ESP raw = ");
-    Serial.println(showEspRaw ? "ON" : "OFF");
+    Serial.print(F("ESP raw = "));
+    Serial.println(showEspRaw ? F("ON") : F("OFF"));
+  }
+  else if (isCommand(cmd, PSTR("toggle_passthrough"))) {
+    esp.usePassthrough = !esp.usePassthrough;
+    Serial.print(F("ESP pass-through uploads = "));
+    Serial.print(esp.usePassthrough ? F("ON") : F("OFF"));
+    // the driver latches the mode per request
+    Serial.println(sysStatus.espState == Status::ESPState::SENDING ? F(" (from the next request)") : F(""));
   }
   else {
-    Serial.print("Unknown: ");
+    Serial.print(F("Unknown: "));
     Serial.println(cmd);
-    Serial.println("Commands: esp on | esp off | send | status | dump | clear | toggle_esp_raw");
+    Serial.println(F("Commands: esp on | esp off | esp | pir | stats | latency | send | status | status all | query <from_s> <to_s> [list] [scan] | dump | export | export all | bench | clear | toggle_esp_raw | toggle_passthrough"));
   }
 
   Serial.println();
@@ -82,22 +403,37 @@ void setup() {
   Serial.begin(SERIAL_BAUD);
   delay(200);
   Serial.println();
-  Serial.println("=== IoT Motion Logger ===");
+  Serial.println(F("=== IoT Motion Logger ==="));
   Serial.println();
 
   // initialize status and storage
   sysStatus.init();
-  eepromStorage.begin(); // loads count/head and persistent event counter
+  eepromStorage.setCursorLossy(EEPROMStorage::CURSOR_EXPORT, !EXPORT_BLOCKING);
+  eepromStorage.begin(&sysStatus); // loads count/head, cursors and persistent sequence counter
+  if (resetFlags & _BV(WDRF)) {
+    Serial.println(F("[MAIN] Restarted by the watchdog (loop() hung)."));
+    sysStatus.counters.watchdogResets = eepromStorage.noteWatchdogReset();
+  } else {
+    sysStatus.counters.watchdogResets = eepromStorage.watchdogResets();
+  }
 
-  // initialize motion detector and give it storage & status
+  // initialize motion detector and give it storage & status (warm-up runs in the background)
+  motion.setWarmup(PIR_WARMUP_MS, PIR_WARMUP_TAG);
   motion.begin(&sysStatus, &eepromStorage);
+  motion.setAlerts(true, ALERT_DEBOUNCE_MS);
+  motion.setCheckpointInterval(CHECKPOINT_INTERVAL_MS);
+  motion.setMergeGap(MERGE_GAP_MS);
+  motion.setStats(&occupancy);
 
   // initialize ESP driver with pointers
   esp.begin(&sysStatus, &eepromStorage);
 
-  // Do NOT auto power on ESP
+  // ESP stays off unless configured to boot now, alongside the PIR warm-up
+  if (ESP_AUTO_ON) esp.powerOn();
   sysStatus.print(Serial);
   Serial.println();
+
+  if (LOOP_WATCHDOG) wdt_enable(WDTO_8S);
 }
 
 void loop() {
@@ -106,6 +442,7 @@ void loop() {
 
   // 2) PIR detection (handles warm-up and storage)
   motion.loop();
+  if (SERIAL_UI && binaryLink.subscribed()) publishLinkEvents();
 
   // 3) ESP state machine (silent if OFF)
   esp.loop(showEspRaw);
@@ -114,28 +451,58 @@ void loop() {
   unsigned long now = millis();
   bool canSendNow = (now - lastThingSpeakSendTime) >= THINGSPEAK_MIN_INTERVAL;
 
-  if (sysStatus.espState == Status::ESPState::READY &&
+  unsigned long deliveredAlertTs;
+  uint8_t deliveredAlertCh;
+  if (esp.takeAlertDelivered(deliveredAlertTs, deliveredAlertCh)) motion.clearAlert(deliveredAlertCh, deliveredAlertTs);
+
+  // motion-start alerts take the next free ESP slot ahead of the stored readings. ThingSpeak
+  // times its limit between arrivals, so a request that reached it late would make an alert
+  // sent 15 s after that request's start arrive too early: wait 15 s from its reply too
+  bool alertSlot = (now - lastThingSpeakSendTime) >= ALERT_MIN_INTERVAL &&
+                   (esp.lastReplyTime() == 0 || (now - esp.lastReplyTime()) >= ALERT_MIN_INTERVAL);
+  if (sysStatus.espState == Status::ESPState::READY && motion.hasAlert() && alertSlot) {
+    Serial.print(F("[MAIN] Sending motion alert -> start="));
+    Serial.println(motion.alertTime());
+    if (esp.sendAlertToThingSpeak(motion.alertTime(), motion.alertChannel())) {
+      lastThingSpeakSendTime = now;
+      sysStatus.lastSendAttemptTime = now;
+    }
+  }
+  else if (sysStatus.espState == Status::ESPState::READY &&
       eepromStorage.hasPending() &&
       (esp.requestImmediateSend || canSendNow)) {
 
     EEPROMStorage::Reading r;
-    if (eepromStorage.peekOldest(r)) {
-      Serial.print("[MAIN] Sending oldest reading -> dur_sec=");
-      Serial.print(r.duration_sec);
-      Serial.print("  evt#=");
-      Serial.println(r.eventCounter);
+    if (eepromStorage.peekNext(EEPROMStorage::CURSOR_CLOUD, r)) {
+      Serial.print(F("[MAIN] Sending oldest reading -> dur_ms="));
+      Serial.print(r.duration_ms);
+      Serial.print(F("  seq="));
+      Serial.println(r.seq);
 
-      if (esp.sendReadingToThingSpeak(r)) {
+      // summary fields ride along on the reading's request: no extra uploads for them
+      char summary[ESP_EXTRA_FIELDS_MAX + 1] = "";
+      bool fit = true;
+      if (UPLOAD_STATS) fit = occupancy.formatFields(summary, sizeof(summary), now);
+      if (UPLOAD_HEALTH) {
+        size_t n = strlen(summary);
+        if (n) summary[n++] = '&';
+        fit = sysStatus.formatHealth(summary + n, sizeof(summary) - n) && fit;
+      }
+      if (!fit) sysStatus.counters.fieldsTruncated++;
+      if (esp.sendReadingToThingSpeak(r, summary)) {
         // start timestamp for rate limiting
         lastThingSpeakSendTime = now;
         esp.requestImmediateSend = false;
         sysStatus.lastSendAttemptTime = now;
       } else {
-        Serial.println("[MAIN] ESP could not start send (busy).");
+        Serial.println(F("[MAIN] ESP could not start send (busy)."));
       }
     }
   }
 
-  // small idle delay
-  delay(20);
+  // small idle delay; keeps draining the ESP port at a rate set by its baud
+  esp.idle(20, showEspRaw);
+
+  // only a pass that made it all the way round feeds the watchdog
+  wdt_reset();
 }
@@ -2,6 +2,20 @@
 // Handles PIR input, measures duration of motion events (milliseconds),
 // stores completed events in EEPROMStorage (via push).
 // Minimizes writes: only writes when an event completes.
+// Rising edges raise a motion-start alert (RAM only, one slot per channel) that main sends ahead
+// of the stored queue.
+// Long events are checkpointed into storage every checkpointIntervalMs as in-progress records;
+// the final record replaces the checkpoint if it has not been uploaded yet.
+// Retriggers: a rising edge within mergeGapMs of the last falling edge extends the current event
+// instead of starting a new one; the number of merged PIR pulses is stored with the reading.
+// Warm-up: for warmupMs after begin() the HC-SR501 emits settle pulses. These are discarded
+// (or stored tagged FLAG_WARMUP) and raise no alerts. Timed with millis(), never blocks.
+//
+// MotionDetectorCore<CHANNELS> holds the event logic for up to 8 PIR zones, fed one bitmask of
+// pin levels per loop. MotionDetector is the single-pin front end (digitalRead, pin chosen at
+// runtime); PortMotionDetector<Port, PinMask> samples every zone on one AVR port with a single
+// PINx read, and PinMotionDetector<PIN> is its one-pin form with the pin fixed at compile time.
+// Each Reading carries the zone's channel id (0 = lowest pin in the mask).
 
 #ifndef MOTION_DETECTOR_H
 #define MOTION_DETECTOR_H
@@ -9,69 +23,232 @@
 #include <Arduino.h>
 #include "EEPROMStorage.h"
 #include "Status.h"
+#include "FastPin.h"
+#include "OccupancyStats.h"
+
+constexpr uint8_t pirBitCount(uint8_t m) { return m ? (m & 1) + pirBitCount(m >> 1) : 0; }
+constexpr uint8_t pirLowestBit(uint8_t m) { return (m & 1) ? 0 : 1 + pirLowestBit(m >> 1); }
+constexpr bool pirIsContiguous(uint8_t m) { return (((m >> pirLowestBit(m)) + 1) & (m >> pirLowestBit(m))) == 0; }
+
+template<uint8_t CHANNELS>
+class MotionDetectorCore {
+  static_assert(CHANNELS >= 1 && CHANNELS <= 8, "one bit per channel in a uint8_t");
 
-class MotionDetector {
   public:
-    MotionDetector(uint8_t pin) : pirPin(pin) {}
+    // settle time after power-up; tagEvents stores warm-up events with FLAG_WARMUP instead of
+    // dropping them. Call before begin().
+    void setWarmup(unsigned long ms, bool tagEvents = false) {
+      warmupMs = ms;
+      warmupTag = tagEvents;
+    }
+    bool isWarmingUp() const { return warmingUp; }
 
-    void begin(Status *statusPtr = nullptr) {
-      status = statusPtr;
-      pinMode(pirPin, INPUT);
-      lastState = digitalRead(pirPin);
-      if (status) status->pirState = (lastState ? Status::PIRState::MOTION : Status::PIRState::IDLE);
+    // motion-start alert lane
+    void setAlerts(bool enabled, unsigned long debounceMs = 0) {
+      alertsEnabled = enabled;
+      alertDebounceMs = debounceMs;
     }
+    // 0 closes every event on its falling edge
+    void setMergeGap(unsigned long ms) { mergeGapMs = ms; }
+    // 0 disables in-progress checkpoints
+    void setCheckpointInterval(unsigned long ms) { checkpointIntervalMs = ms; }
 
-    // main loop: call frequently
-    void loop() {
-      int state = digitalRead(pirPin);
-      unsigned long now = millis();
-
-      if (state && !lastState) {
-        // rising edge - motion started
-        motionStart = now;
-        motionActive = true;
-        if (status) status->pirState = Status::PIRState::MOTION;
-      } else if (!state && lastState && motionActive) {
-        // falling edge - motion ended
-        unsigned long duration = now - motionStart;
-        onMotionComplete(duration, motionStart);
-        motionActive = false;
-        if (status) status->pirState = Status::PIRState::IDLE;
-      }
-      lastState = state;
+    static const uint8_t channels = CHANNELS;
+
+    bool hasAlert() const { return alertMask != 0; }
+    // channels with an undelivered alert (bit c = channel c)
+    uint8_t alertChannels() const { return alertMask; }
+    // the alert to send next: the pending one with the oldest motion start
+    uint8_t alertChannel() const {
+      uint8_t next = 0;
+      for (uint8_t c = 0; c < CHANNELS; ++c)
+        if (((alertMask >> c) & 1) && (!((alertMask >> next) & 1) || (long)(alertTs[c] - alertTs[next]) < 0)) next = c;
+      return next;
     }
+    unsigned long alertTime() const { return alertTs[alertChannel()]; }
+    unsigned long alertTime(uint8_t c) const { return alertTs[c]; }
+    // an alert was delivered: clear it only if it is still the channel's pending one (a newer
+    // motion start raised while it was in flight stays pending)
+    void clearAlert(uint8_t c, unsigned long ts) { if (c < CHANNELS && ts == alertTs[c]) alertMask &= ~(1 << c); }
 
     // summary print
     void printSummary(Print &out) {
-      out.print("MotionActive: ");
-      out.print(motionActive ? "YES" : "NO");
-      out.print("  currState: ");
-      out.print(lastState ? "HIGH" : "LOW");
-      out.print("  lastDur(ms): ");
-      out.print(lastDurationMs);
+      for (uint8_t c = 0; c < CHANNELS; ++c) {
+        if (CHANNELS > 1) { out.print(F("ch")); out.print(c); out.print(F(": ")); }
+        out.print(F("MotionActive: "));
+        out.print(ch[c].active ? F("YES") : F("NO"));
+        out.print(F("  currState: "));
+        out.print((lastLevels >> c) & 1 ? F("HIGH") : F("LOW"));
+        out.print(F("  lastDur(ms): "));
+        out.print(ch[c].lastDurationMs);
+        if (CHANNELS > 1) out.println();
+      }
+      out.print(F("  stored: "));
+      out.print(eventsStored);
+      out.print(F("  mergedEdges: "));
+      out.print(mergedEdges);
     }
 
     // set storage pointer (alternatively, main will push)
     void setStorage(EEPROMStorage *s) { storage = s; }
+    // completed events are also fed to the statistics engine
+    void setStats(OccupancyStats *s) { stats = s; }
+
+  protected:
+    void beginCore(Status *statusPtr, EEPROMStorage *storagePtr, uint8_t levels) {
+      status = statusPtr;
+      if (storagePtr) storage = storagePtr;
+      lastLevels = levels;
+      warmupStart = millis();
+      warmingUp = warmupMs > 0;
+      if (warmingUp) {
+        Serial.print(F("[PIR] Warm-up started (")); Serial.print(warmupMs / 1000); Serial.println(F(" sec)"));
+        if (status) status->pirState = Status::PIRState::WARMUP;
+      } else if (status) {
+        status->pirState = (lastLevels ? Status::PIRState::MOTION : Status::PIRState::IDLE);
+      }
+    }
+
+    // one sample of all channels: bit c of levels is channel c's PIR output
+    void update(uint8_t levels, unsigned long now) {
+      if (warmingUp) {
+        if (now - warmupStart >= warmupMs) {
+          warmingUp = false;
+          Serial.println(F("[PIR] Warm-up complete. PIR active."));
+        } else if (!warmupTag) {
+          // discard settle pulses: track the levels but never open an event
+          lastLevels = levels;
+          return;
+        }
+      }
+
+      // edges for all channels at once; only changed channels are visited
+      uint8_t changed = levels ^ lastLevels;
+      lastLevels = levels;
+      while (changed) {
+        uint8_t c = __builtin_ctz(changed);
+        changed &= changed - 1;
+        if ((levels >> c) & 1) onRise(c, now);
+        else onFall(c, now);
+      }
+
+      // timers (merge gap, checkpoints, alert debounce) only for channels with an open event
+      uint8_t open = openMask;
+      while (open) {
+        uint8_t c = __builtin_ctz(open);
+        open &= open - 1;
+        service(c, now);
+      }
+
+      if (status && !warmingUp) status->pirState = levels ? Status::PIRState::MOTION : Status::PIRState::IDLE;
+    }
+
+    uint8_t lastLevels = 0;
 
   private:
-    uint8_t pirPin;
-    int lastState = 0;
-    bool motionActive = false;
-    unsigned long motionStart = 0;
-    unsigned long lastDurationMs = 0;
+    struct Channel {
+      bool active = false;
+      bool closing = false;         // falling edge seen, waiting out the merge gap
+      bool startedInWarmup = false; // open event began during warm-up (tag mode)
+      bool alertArmed = false;
+      uint8_t subEvents = 0;
+      unsigned long start = 0;
+      unsigned long end = 0;
+      unsigned long lastCheckpoint = 0;
+      unsigned long lastDurationMs = 0;
+    };
+
+    Channel ch[CHANNELS];
+    uint8_t openMask = 0;
+    bool alertsEnabled = true;
+    unsigned long alertDebounceMs = 0;
+    uint8_t alertMask = 0;
+    unsigned long alertTs[CHANNELS] = {};
+    unsigned long warmupMs = 0;
+    unsigned long warmupStart = 0;
+    bool warmingUp = false;
+    bool warmupTag = false;
+    unsigned long mergeGapMs = 0;
+    uint16_t eventsStored = 0;  // final records written
+    uint16_t mergedEdges = 0;   // retriggers folded into an open event
+    unsigned long checkpointIntervalMs = 0;
     EEPROMStorage *storage = nullptr;
+    OccupancyStats *stats = nullptr;
     Status *status = nullptr;
 
+    void onRise(uint8_t c, unsigned long now) {
+      Channel &e = ch[c];
+      if (e.closing) {
+        // retrigger inside the merge gap - same event continues
+        e.closing = false;
+        if (e.subEvents < 255) ++e.subEvents; // stored in one byte: saturates on long trains
+        ++mergedEdges;
+        return;
+      }
+      // rising edge - motion started
+      e.start = now;
+      e.active = true;
+      e.subEvents = 1;
+      e.lastCheckpoint = now;
+      e.startedInWarmup = warmingUp;
+      e.alertArmed = alertsEnabled && !warmingUp;
+      openMask |= (1 << c);
+    }
+
+    void onFall(uint8_t c, unsigned long now) {
+      Channel &e = ch[c];
+      if (!e.active) return;
+      // falling edge - motion ended (or paused, if a retrigger follows within the gap)
+      e.end = now;
+      e.closing = true;
+      e.alertArmed = false; // shorter than the debounce time: no alert
+    }
+
+    void service(uint8_t c, unsigned long now) {
+      Channel &e = ch[c];
+      if (e.closing && now - e.end >= mergeGapMs) {
+        onMotionComplete(c, e.end - e.start, e.start);
+        e.closing = false;
+        e.active = false;
+        openMask &= ~(1 << c);
+        return;
+      }
+
+      // periodic in-progress checkpoint of a long event
+      if (checkpointIntervalMs && now - e.lastCheckpoint >= checkpointIntervalMs) {
+        e.lastCheckpoint = now;
+        storeReading(c, (e.closing ? e.end : now) - e.start, e.start, EEPROMStorage::FLAG_IN_PROGRESS);
+      }
+
+      // raise the alert once motion has lasted alertDebounceMs. One slot per channel, not a queue:
+      // a newer start on the same zone replaces its undelivered alert, so the ack of one already
+      // in flight cannot clear it; other zones keep theirs
+      if (e.alertArmed && now - e.start >= alertDebounceMs) {
+        e.alertArmed = false;
+        alertMask |= (1 << c);
+        alertTs[c] = e.start;
+      }
+    }
+
     // Called when a motion event completes
-    void onMotionComplete(unsigned long duration_ms, unsigned long ts) {
-      lastDurationMs = duration_ms;
-      // store reading into storage (if available)
+    void onMotionComplete(uint8_t c, unsigned long duration_ms, unsigned long ts) {
+      ch[c].lastDurationMs = duration_ms;
+      if (stats) stats->addEvent(duration_ms, ts + duration_ms);
+      storeReading(c, duration_ms, ts, 0);
+    }
+
+    // store reading into storage (if available); supersedes this event's checkpoint
+    void storeReading(uint8_t c, unsigned long duration_ms, unsigned long ts, uint8_t flags) {
       if (storage) {
         EEPROMStorage::Reading r;
         r.duration_ms = duration_ms;
         r.ts = ts;
-        if (storage->push(r)) {
+        r.seq = 0; // assigned by storage
+        r.flags = flags | (ch[c].startedInWarmup ? EEPROMStorage::FLAG_WARMUP : 0);
+        r.subEvents = ch[c].subEvents;
+        r.channel = c;
+        if (storage->pushOrReplace(r)) {
+          if (!(flags & EEPROMStorage::FLAG_IN_PROGRESS)) ++eventsStored;
           if (status) {
             status->storedReadingsCount = storage->size();
           }
@@ -82,4 +259,57 @@ class MotionDetector {
     }
 };
 
+// Single PIR on any pin
+class MotionDetector : public MotionDetectorCore<1> {
+  public:
+    MotionDetector(uint8_t pin) : pirPin(pin) {}
+
+    void begin(Status *statusPtr = nullptr, EEPROMStorage *storagePtr = nullptr) {
+      pinMode(pirPin, INPUT);
+      beginCore(statusPtr, storagePtr, digitalRead(pirPin) ? 1 : 0);
+    }
+
+    // main loop: call frequently
+    void loop() {
+      update(digitalRead(pirPin) ? 1 : 0, millis());
+    }
+
+  private:
+    uint8_t pirPin;
+};
+
+// Several PIR zones on one AVR port, e.g. PortMotionDetector<AvrPortD, _BV(2) | _BV(3) | _BV(4)>
+// for pins 2..4 as channels 0..2. All zones are sampled with one port read per loop.
+template<class Port, uint8_t PinMask>
+class PortMotionDetector : public MotionDetectorCore<pirBitCount(PinMask)> {
+  public:
+    void begin(Status *statusPtr = nullptr, EEPROMStorage *storagePtr = nullptr) {
+      Port::makeInputs(PinMask);
+      this->beginCore(statusPtr, storagePtr, readLevels());
+    }
+
+    // main loop: call frequently
+    void loop() {
+      this->update(readLevels(), millis());
+    }
+
+  private:
+    // port bits -> channel bits (channel c = c-th set bit of PinMask)
+    static uint8_t readLevels() {
+      uint8_t raw = Port::read() & PinMask;
+      if (pirIsContiguous(PinMask)) return raw >> pirLowestBit(PinMask);
+      uint8_t levels = 0, out = 1;
+      for (uint8_t b = 1; b; b <<= 1) {
+        if (!(PinMask & b)) continue;
+        if (raw & b) levels |= out;
+        out <<= 1;
+      }
+      return levels;
+    }
+};
+
+// Single PIR with the pin fixed at compile time: one PINx read per sample instead of digitalRead
+template<uint8_t PIN>
+using PinMotionDetector = PortMotionDetector<typename FastPin<PIN>::Port, FastPin<PIN>::MASK>;
+
 #endif
@@ -0,0 +1,162 @@
+// OccupancyStats.h
+// On-device occupancy statistics, updated in O(1) per completed motion event.
+// - hourly buckets (hours since boot, millis based, wrap safe): occupied seconds, event count and
+//   longest event per hour. One more bucket than STATS_HOURS is kept so a query for the last N
+//   hours is a trailing window: the current hour so far, the N-1 before it, and the share of
+//   the hour before those that still lies inside the window (counts prorated by that share).
+// - duration histogram since boot in power-of-two second bins (<1s, 1-2s, 2-4s, ... >=128s)
+// An event is booked to the hour it ended in (capped at one hour of occupancy).
+
+#ifndef OCCUPANCY_STATS_H
+#define OCCUPANCY_STATS_H
+
+#include <Arduino.h>
+
+class OccupancyStats {
+  public:
+    static const uint8_t STATS_HOURS = 24;
+    static const uint8_t HIST_BINS = 9;
+    static const unsigned long HOUR_MS = 3600000UL;
+
+    // called once per completed event (fed by MotionDetector)
+    void addEvent(unsigned long duration_ms, unsigned long endTime) {
+      advanceTo(endTime);
+      ++hist[histBin(duration_ms / 1000)];
+      ++totalEvents;
+      // the event may have ended before the last query moved the window on
+      unsigned long age = ((long)(lastNow - endTime) > 0) ? lastNow - endTime : 0;
+      uint8_t hoursAgo = 0;
+      if (age > intoHourMs) {
+        unsigned long h = 1 + (age - intoHourMs - 1) / HOUR_MS;
+        if (h >= BUCKETS) return;
+        hoursAgo = h;
+      }
+      Bucket &b = buckets[idx(hoursAgo)];
+      uint16_t sec = duration_ms >= HOUR_MS ? 3600 : duration_ms / 1000;
+      b.occupiedSec = (b.occupiedSec + sec > 3600) ? 3600 : b.occupiedSec + sec;
+      if (b.events < 255) ++b.events;
+      if (sec > b.longestSec) b.longestSec = sec;
+    }
+
+    // occupied share of the last `hours` hours (since boot, if that is shorter), in permille
+    uint16_t occupancyPermille(unsigned long now, uint8_t hours) {
+      advanceTo(now);
+      if (hours > STATS_HOURS) hours = STATS_HOURS;
+      unsigned long occupied = 0;
+      for (uint8_t i = 0; i < hours; ++i) occupied += buckets[idx(i)].occupiedSec;
+      occupied += prorated(buckets[idx(hours)].occupiedSec, hours);
+      unsigned long elapsed = windowSec(hours);
+      if (!elapsed) return 0;
+      unsigned long pm = occupied * 1000UL / elapsed;
+      return pm > 1000 ? 1000 : pm;
+    }
+
+    // events in the last `hours` hours (the oldest, partly covered hour prorated)
+    uint16_t events(unsigned long now, uint8_t hours) {
+      advanceTo(now);
+      if (hours > STATS_HOURS) hours = STATS_HOURS;
+      uint16_t n = 0;
+      for (uint8_t i = 0; i < hours; ++i) n += buckets[idx(i)].events;
+      return n + prorated(buckets[idx(hours)].events, hours);
+    }
+
+    // longest single event (seconds) in the hours the last `hours` hours touch
+    uint16_t longestSec(unsigned long now, uint8_t hours) {
+      advanceTo(now);
+      if (hours > STATS_HOURS) hours = STATS_HOURS;
+      uint16_t m = 0;
+      for (uint8_t i = 0; i <= hours; ++i)
+        if (buckets[idx(i)].longestSec > m) m = buckets[idx(i)].longestSec;
+      return m;
+    }
+
+    // summary fields appended to an upload: field7 = occupancy last hour (permille), field8 = events
+    // last hour (at most 24 characters); false if they did not fit in len
+    bool formatFields(char *buf, size_t len, unsigned long now) {
+      int n = snprintf_P(buf, len, PSTR("field7=%u&field8=%u"), occupancyPermille(now, 1), events(now, 1));
+      return n >= 0 && (size_t)n < len;
+    }
+
+    void print(Print &out, unsigned long now) {
+      out.print(F("Occupancy 1h: ")); printPermille(out, occupancyPermille(now, 1));
+      out.print(F("  24h: ")); printPermille(out, occupancyPermille(now, STATS_HOURS));
+      out.print(F("  | Events 1h: ")); out.print(events(now, 1));
+      out.print(F("  24h: ")); out.print(events(now, STATS_HOURS));
+      out.print(F("  total: ")); out.print(totalEvents);
+      out.print(F("  | Longest(s) 1h: ")); out.print(longestSec(now, 1));
+      out.print(F("  24h: ")); out.println(longestSec(now, STATS_HOURS));
+      out.print(F("Durations(s):"));
+      for (uint8_t i = 0; i < HIST_BINS; ++i) {
+        out.print(i == 0 ? F(" <1:") : (i == HIST_BINS - 1 ? F(" >=") : F(" ")));
+        if (i) out.print(1UL << (i - 1));
+        if (i && i < HIST_BINS - 1) { out.print('-'); out.print(1UL << i); }
+        if (i) out.print(':');
+        out.print(hist[i]);
+      }
+      out.println();
+    }
+
+  private:
+    struct Bucket {
+      uint16_t occupiedSec;
+      uint8_t events;
+      uint16_t longestSec;
+    };
+
+    static const uint8_t BUCKETS = STATS_HOURS + 1;
+
+    Bucket buckets[BUCKETS] = {};
+    uint8_t current = 0;           // bucket of the current hour
+    unsigned long hoursElapsed = 0; // completed hours since boot
+    unsigned long intoHourMs = 0;   // time spent in the current hour
+    unsigned long lastNow = 0;
+    uint16_t hist[HIST_BINS] = {};
+    uint16_t totalEvents = 0;
+
+    // i hours ago -> bucket index
+    uint8_t idx(uint8_t i) const { return (current + BUCKETS - i) % BUCKETS; }
+
+    // rotate the ring forward to now, clearing the hours passed (earlier times are ignored)
+    void advanceTo(unsigned long now) {
+      long dt = (long)(now - lastNow);
+      if (dt <= 0) return;
+      lastNow = now;
+      intoHourMs += dt;
+      uint8_t cleared = 0;
+      while (intoHourMs >= HOUR_MS) {
+        intoHourMs -= HOUR_MS;
+        ++hoursElapsed;
+        if (cleared < BUCKETS) {
+          current = (current + 1) % BUCKETS;
+          buckets[current] = Bucket();
+          ++cleared;
+        }
+      }
+    }
+
+    // seconds in the last `hours` hours, or since boot while that is shorter
+    unsigned long windowSec(uint8_t hours) const {
+      if (hoursElapsed >= hours) return hours * 3600UL;
+      return hoursElapsed * 3600UL + intoHourMs / 1000;
+    }
+
+    // the part of bucket `hours` (hours ago) still inside a window of that many hours: the rest
+    // of that hour after the point the current hour has reached
+    uint16_t prorated(uint16_t v, uint8_t hours) const {
+      if (hoursElapsed < hours) return 0; // that hour was before boot
+      unsigned long insideSec = (HOUR_MS - intoHourMs) / 1000;
+      return (v * insideSec + 1800) / 3600;
+    }
+
+    static uint8_t histBin(unsigned long sec) {
+      uint8_t bin = 0;
+      while (sec && bin < HIST_BINS - 1) { sec >>= 1; ++bin; }
+      return bin;
+    }
+
+    static void printPermille(Print &out, uint16_t pm) {
+      out.print(pm / 10); out.print('.'); out.print(pm % 10); out.print('%');
+    }
+};
+
+#endif
@@ -0,0 +1,70 @@
+// SerialExport.h
+// Binary export of stored readings over Serial ("export" command), decoded on the host by
+// tools/export_decode.py. Each frame:
+//   0xA5 | type | len | payload[len] | crc16 (little endian)
+// crc16 is CRC-16/MCRF4XX (avr-libc _crc_ccitt_update, start 0xFFFF) over type, len and payload.
+// Frames:
+//   'H' header  - format version, READING_BYTES, readings to follow, millis() now, boot seq
+//   'R' records - up to EXPORT_CHUNK readings exactly as stored in EEPROM (see EEPROMStorage.h)
+//   'E' end     - readings sent (uint8_t)
+// A reading costs 12 bytes plus ~1.3 bytes of framing, against ~50 characters in the text dump.
+
+#ifndef SERIAL_EXPORT_H
+#define SERIAL_EXPORT_H
+
+#include <Arduino.h>
+#include <util/crc16.h>
+#include "EEPROMStorage.h"
+
+class SerialExport {
+  public:
+    static const uint8_t SYNC = 0xA5;
+    static const uint8_t VERSION = 1;
+    static const uint8_t EXPORT_CHUNK = 4; // readings per 'R' frame (48-byte stack buffer)
+
+    // Stream the readings not yet taken by the export cursor and advance it, or (all = true)
+    // every stored reading without touching the cursor. Returns the number of readings sent.
+    static uint8_t run(Print &out, EEPROMStorage &storage, bool all) {
+      uint8_t start = all ? 0 : storage.size() - storage.pending(EEPROMStorage::CURSOR_EXPORT);
+      uint8_t n = storage.size() - start;
+
+      uint8_t hdr[9];
+      unsigned long now = millis();
+      uint16_t bootSeq = storage.bootSequence();
+      hdr[0] = VERSION;
+      hdr[1] = EEPROMStorage::READING_BYTES;
+      hdr[2] = n;
+      for (uint8_t i = 0; i < 4; ++i) hdr[3 + i] = (now >> (8 * i)) & 0xFF;
+      hdr[7] = bootSeq & 0xFF;
+      hdr[8] = bootSeq >> 8;
+      frame(out, 'H', hdr, sizeof(hdr));
+
+      uint8_t raw[EXPORT_CHUNK * EEPROMStorage::READING_BYTES];
+      uint8_t sent = 0;
+      while (sent < n) {
+        uint8_t got = storage.peekRaw(start + sent, n - sent < EXPORT_CHUNK ? n - sent : EXPORT_CHUNK, raw);
+        if (!got) break;
+        frame(out, 'R', raw, got * EEPROMStorage::READING_BYTES);
+        sent += got;
+      }
+      frame(out, 'E', &sent, 1);
+
+      if (!all) storage.advance(EEPROMStorage::CURSOR_EXPORT, sent);
+      return sent;
+    }
+
+  private:
+    static void frame(Print &out, uint8_t type, const uint8_t *payload, uint8_t len) {
+      uint16_t crc = 0xFFFF;
+      crc = _crc_ccitt_update(crc, type);
+      crc = _crc_ccitt_update(crc, len);
+      for (uint8_t i = 0; i < len; ++i) crc = _crc_ccitt_update(crc, payload[i]);
+      uint8_t head[3] = { SYNC, type, len };
+      uint8_t tail[2] = { (uint8_t)(crc & 0xFF), (uint8_t)(crc >> 8) };
+      out.write(head, 3);
+      out.write(payload, len);
+      out.write(tail, 2);
+    }
+};
+
+#endif
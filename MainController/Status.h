@@ -5,12 +5,14 @@
 #define STATUS_H
 
 #include <Arduino.h>
+#include "LatencySketch.h"
 
 struct Status {
   enum class ESPState : uint8_t { OFF=0, BOOTING=1, READY=2, SENDING=3, ERROR=4 };
-  enum class PIRState : uint8_t { OFF=0, IDLE=1, MOTION=2 };
+  enum class PIRState : uint8_t { OFF=0, IDLE=1, MOTION=2, WARMUP=3 };
 
-  ESPState espState;
+  ESPState espState;       // change with setEspState() so espStateSince stays right
+  unsigned long espStateSince;
   PIRState pirState;
 
   uint8_t storedReadingsCount;
@@ -18,38 +20,137 @@ struct Status {
   unsigned long lastSendSuccessTime;
   bool lastSendOk;
 
+  // edge-to-cloud latency of the last delivered alert (rising edge) and reading (falling edge)
+  unsigned long lastAlertLatencyMs;
+  unsigned long lastEventLatencyMs;
+  // event-end-to-entry-id latency of every reading delivered since boot
+  LatencySketch eventLatency;
+
+  // Telemetry counters since boot. Modules bump these with plain increments;
+  // uint16_t counters wrap, which is fine for rate/delta monitoring.
+  struct Counters {
+    uint16_t sendsAttempted;    // requests started (readings + alerts)
+    uint16_t sendsOk;           // requests ThingSpeak answered with an entry id
+    uint16_t sendsFailed;       // SEND FAIL, entry id 0, no reply, reply lost
+    uint16_t retries;           // a reading sent again after a failed attempt
+    uint32_t bytesSent;         // bytes written to the ESP (AT commands + payloads)
+    uint16_t eepromWrites;      // EEPROM bytes actually rewritten
+    uint8_t queueHighWater;     // most readings stored at once
+    uint16_t espReboots;        // power-ons and power cycles of the ESP
+    unsigned long maxEventToUploadMs; // worst falling-edge-to-entry-id latency
+    uint16_t rxOverflows;       // SoftwareSerial RX buffer overflowed (bytes lost)
+    uint16_t rxTruncatedLines;  // ESP lines longer than the line buffer
+    uint16_t espRecoveries;     // ESP states that outstayed their limit and were reset
+    uint8_t watchdogResets;     // loop() hangs ended by the AVR watchdog (kept in EEPROM)
+    uint32_t rxBytes;           // bytes read from the ESP port (lost bytes = sent by the ESP - this)
+    uint16_t fieldsTruncated;   // upload field lists or requests cut short by their buffer
+    uint32_t eepromReads;       // EEPROM read calls (byte reads and block reads)
+    uint32_t eepromReadBytes;   // bytes those calls read
+    uint16_t readingsDrained;   // readings removed from the store (delivered or reclaimed)
+  };
+  Counters counters;
+
   void init() {
     espState = ESPState::OFF;
+    espStateSince = 0;
     pirState = PIRState::IDLE;
     storedReadingsCount = 0;
     lastSendAttemptTime = 0;
     lastSendSuccessTime = 0;
     lastSendOk = false;
+    lastAlertLatencyMs = 0;
+    lastEventLatencyMs = 0;
+    eventLatency.init();
+    counters = Counters();
+  }
+
+  void setEspState(ESPState s) {
+    if (s == espState) return;
+    espState = s;
+    espStateSince = millis();
   }
 
-  void print(Print &out) {
-    out.print("ESP: ");
+  void print(Print &out, bool withCounters = false) {
+    out.print(F("ESP: "));
     switch(espState) {
-      case ESPState::OFF: out.print("OFF"); break;
-      case ESPState::BOOTING: out.print("BOOTING"); break;
-      case ESPState::READY: out.print("READY"); break;
-      case ESPState::SENDING: out.print("SENDING"); break;
-      case ESPState::ERROR: out.print("ERROR"); break;
+      case ESPState::OFF: out.print(F("OFF")); break;
+      case ESPState::BOOTING: out.print(F("BOOTING")); break;
+      case ESPState::READY: out.print(F("READY")); break;
+      case ESPState::SENDING: out.print(F("SENDING")); break;
+      case ESPState::ERROR: out.print(F("ERROR")); break;
     }
-    out.print("  | PIR: ");
+    out.print(F("  | PIR: "));
     switch(pirState) {
-      case PIRState::OFF: out.print("OFF"); break;
-      case PIRState::IDLE: out.print("IDLE"); break;
-      case PIRState::MOTION: out.print("MOTION"); break;
+      case PIRState::OFF: out.print(F("OFF")); break;
+      case PIRState::IDLE: out.print(F("IDLE")); break;
+      case PIRState::MOTION: out.print(F("MOTION")); break;
+      case PIRState::WARMUP: out.print(F("WARMUP")); break;
     }
-    out.print("  | Stored: ");
+    out.print(F("  | Stored: "));
     out.print((int)storedReadingsCount);
-    out.print("  | LastSendOk: ");
-    out.print(lastSendOk ? "YES" : "NO");
-    out.print("  | LastSendAt: ");
+    out.print(F("  | LastSendOk: "));
+    out.print(lastSendOk ? F("YES") : F("NO"));
+    out.print(F("  | LastSendAt: "));
     out.print(lastSendSuccessTime);
+    out.print(F("  | AlertLat(ms): "));
+    out.print(lastAlertLatencyMs);
+    out.print(F("  | EventLat(ms): "));
+    out.print(lastEventLatencyMs);
+    out.print(F("  | RxOverflows: "));
+    out.print(counters.rxOverflows);
+    out.print(F("  | RxTruncated: "));
+    out.print(counters.rxTruncatedLines);
+    out.println();
+    if (withCounters) {
+      printCounters(out);
+      out.print(F("EventLat "));
+      eventLatency.print(out);
+    }
+  }
+
+  void printCounters(Print &out) {
+    out.print(F("Sends: ")); out.print(counters.sendsAttempted);
+    out.print(F("  ok: ")); out.print(counters.sendsOk);
+    out.print(F("  failed: ")); out.print(counters.sendsFailed);
+    out.print(F("  retries: ")); out.print(counters.retries);
+    out.print(F("  | BytesSent: ")); out.print(counters.bytesSent);
+    out.print(F("  | EEPROMWrites: ")); out.print(counters.eepromWrites);
+    out.print(F("  | QueueMax: ")); out.print((int)counters.queueHighWater);
+    out.print(F("  | ESPReboots: ")); out.print(counters.espReboots);
+    out.print(F("  | MaxEventLat(ms): ")); out.print(counters.maxEventToUploadMs);
+    out.print(F("  | ESPRecoveries: ")); out.print(counters.espRecoveries);
+    out.print(F("  | WatchdogResets: ")); out.print((int)counters.watchdogResets);
+    out.print(F("  | RxBytes: ")); out.print(counters.rxBytes);
+    out.print(F("  | FieldsTruncated: ")); out.print(counters.fieldsTruncated);
+    out.println();
+    out.print(F("EEPROMReads: ")); out.print(counters.eepromReads);
+    out.print(F(" (")); out.print(counters.eepromReadBytes); out.print(F(" bytes)"));
+    out.print(F("  | Drained: ")); out.print(counters.readingsDrained);
+    if (counters.readingsDrained) {
+      // everything the store did since boot, spread over the readings it has drained
+      out.print(F("  | per drained reading: reads ")); printRatio(out, counters.eepromReads, counters.readingsDrained);
+      out.print(F(" (")); printRatio(out, counters.eepromReadBytes, counters.readingsDrained); out.print(F(" bytes)"));
+      out.print(F("  writes ")); printRatio(out, counters.eepromWrites, counters.readingsDrained);
+    }
     out.println();
   }
+
+  // num / den with two decimals, without 64-bit math
+  static void printRatio(Print &out, uint32_t num, uint16_t den) {
+    uint8_t centi = (num % den) * 100UL / den;
+    out.print(num / den); out.print('.');
+    if (centi < 10) out.print('0');
+    out.print(centi);
+  }
+
+  // key counters for ThingSpeak's status text, e.g. "status=ok12/14,rt1,q5,rb1,ovf0"
+  // (at most 50 characters); false if it did not fit in len
+  bool formatHealth(char *buf, size_t len) {
+    int n = snprintf_P(buf, len, PSTR("status=ok%u/%u,rt%u,q%u,rb%u,ovf%u"),
+      counters.sendsOk, counters.sendsAttempted, counters.retries,
+      (unsigned)counters.queueHighWater, counters.espReboots, counters.rxOverflows);
+    return n >= 0 && (size_t)n < len;
+  }
 };
 
 #endif
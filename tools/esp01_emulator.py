@@ -0,0 +1,585 @@
+#!/usr/bin/env python3
+"""ESP01 AT-firmware emulator for exercising ESP01Driver without a module, Wi-Fi or ThingSpeak.
+
+Wire a USB-UART adapter where the ESP01 goes (adapter TX -> Uno pin 10, adapter RX -> Uno pin 11,
+common ground) and run the unmodified sketch against it:
+
+    python3 esp01_emulator.py --port /dev/ttyUSB1
+    python3 esp01_emulator.py --port /dev/ttyUSB1 --seed 7 --drop 0.05 --garble 0.02 \\
+        --latency CWJAP=4000,CIPSTART=300,HTTP=600 --outage 120:60:wifi --outage 300:20:stall
+    python3 esp01_emulator.py --port /dev/ttyUSB1 --burst 256:10     # RX overflow bursts
+
+or on a pseudo-terminal for host-side tools (prints the device path):
+
+    python3 esp01_emulator.py --pty
+
+Implements the subset the driver uses: AT, ATE0/1, AT+RST, AT+CWMODE, AT+CWJAP, AT+UART_CUR/DEF,
+AT+CIPMODE, AT+CIPSTART, AT+CIPSEND[=n], AT+CIPCLOSE, "+++", with +IPD, SEND OK/FAIL, CLOSED,
+WIFI CONNECTED / GOT IP and DNS FAIL replies. Requests go to a built-in ThingSpeak stand-in
+(entry ids, optional rate limit) or, with --server, over real TCP to thingspeak_server.py.
+
+Faults are drawn from one seeded RNG, so a run with the same --seed and the same traffic from
+the board fails the same way. Outage kinds (--outage START_S:DURATION_S:KIND, from emulator
+start):
+    wifi   - joins fail, an open link drops with CLOSED, CIPSTART answers ERROR
+    dns    - CIPSTART answers DNS FAIL
+    stall  - requests are accepted (SEND OK) but no reply ever comes back
+    mute   - the module answers nothing at all
+The module's power pin is not visible over the UART, so bytes that no longer frame at a negotiated
+rate are taken as the sketch power-cycling it: the emulator drops back to 4800 baud and forgets
+its Wi-Fi and link state.
+--burst BYTES:EVERY_S writes BYTES of filler lines back to back whenever the link is idle, as a
+chatty module would; the sketch ignores their content, so any it misses were lost to RX overflow
+(rx_burst.py compares the bytes sent with the sketch's RxBytes counter).
+A summary (per-command counts, requests, entries, time to entry id, bytes sent to the sketch) is
+printed on exit (Ctrl-C) and written as JSON with --stats.
+"""
+
+import argparse
+import json
+import os
+import random
+import re
+import socket
+import sys
+import time
+from urllib.parse import parse_qs, urlsplit
+
+from thingspeak_server import Channel
+
+ESP_BAUD_DEFAULT = 4800
+
+
+# --- transports -------------------------------------------------------------------------------
+
+class SerialTransport:
+    def __init__(self, port, baud):
+        import serial  # pyserial
+        self.ser = serial.Serial(port, baud, timeout=0)
+
+    def read(self):
+        return self.ser.read(self.ser.in_waiting or 1)
+
+    def write(self, data):
+        self.ser.write(data)
+        self.ser.flush()
+
+    def set_baud(self, baud):
+        self.ser.baudrate = baud
+
+
+class PtyTransport:
+    def __init__(self):
+        import tty
+        self.master, slave = os.openpty()
+        tty.setraw(slave)
+        self.path = os.ttyname(slave)
+        os.set_blocking(self.master, False)
+
+    def read(self):
+        try:
+            return os.read(self.master, 256)
+        except (BlockingIOError, OSError):
+            return b""
+
+    def write(self, data):
+        os.write(self.master, data)
+
+    def set_baud(self, baud):
+        pass
+
+
+# --- servers behind CIPSTART ------------------------------------------------------------------
+
+class BuiltinThingSpeak:
+    """In-process ThingSpeak: answers /update with an entry id, or 0 inside the rate limit."""
+
+    def __init__(self, rate_limit_s=0.0):
+        self.channel = Channel(rate_limit_s)
+
+    def connect(self, host, port):
+        return BuiltinConnection(self)
+
+    def handle(self, method, target):
+        url = urlsplit(target)
+        if url.path not in ("/update", "/update.json"):
+            return 404, "0"
+        params = {k: v[0] for k, v in parse_qs(url.query).items()}
+        key = params.pop("api_key", "")
+        return 200, str(self.channel.update(key, params))
+
+
+class BuiltinConnection:
+    def __init__(self, server):
+        self.server = server
+        self.buf = b""
+        self.out = b""
+        self.closed_by_peer = False
+
+    def send(self, data):
+        self.buf += data
+        while b"\r\n\r\n" in self.buf:
+            head, self.buf = self.buf.split(b"\r\n\r\n", 1)
+            lines = head.decode("latin-1").split("\r\n")
+            method, target = lines[0].split(" ")[:2]
+            keep_alive = any(l.lower() == "connection: keep-alive" for l in lines[1:])
+            status, body = self.server.handle(method, target)
+            reason = "OK" if status == 200 else "Not Found"
+            self.out += ("HTTP/1.1 %d %s\r\nContent-Type: text/plain; charset=utf-8\r\n"
+                         "Content-Length: %d\r\nConnection: %s\r\n\r\n%s"
+                         % (status, reason, len(body), "keep-alive" if keep_alive else "close", body)).encode()
+            if not keep_alive:
+                self.closed_by_peer = True
+
+    def recv(self):
+        data, self.out = self.out, b""
+        return data
+
+    def close(self):
+        pass
+
+
+class TcpServer:
+    """Forwards the emulated socket to a real TCP server (e.g. thingspeak_server.py)."""
+
+    def __init__(self, address):
+        host, port = address.rsplit(":", 1)
+        self.address = (host, int(port))
+
+    def connect(self, host, port):
+        return TcpConnection(socket.create_connection(self.address, timeout=5))
+
+
+class TcpConnection:
+    def __init__(self, sock):
+        self.sock = sock
+        self.sock.setblocking(False)
+        self.closed_by_peer = False
+
+    def send(self, data):
+        self.sock.sendall(data)
+
+    def recv(self):
+        try:
+            data = self.sock.recv(4096)
+            if not data:
+                self.closed_by_peer = True
+            return data
+        except BlockingIOError:
+            return b""
+        except OSError:
+            self.closed_by_peer = True
+            return b""
+
+    def close(self):
+        self.sock.close()
+
+
+# --- the module -------------------------------------------------------------------------------
+
+class Faults:
+    def __init__(self, args):
+        self.rng = random.Random(args.seed)
+        self.drop = args.drop
+        self.garble = args.garble
+        self.send_fail = args.send_fail
+        self.latency_ms = {}
+        for item in filter(None, (args.latency or "").split(",")):
+            name, ms = item.split("=")
+            self.latency_ms[name.strip().upper()] = float(ms)
+        self.outages = []
+        for spec in args.outage or []:
+            start, duration, kind = spec.split(":")
+            self.outages.append((float(start), float(duration), kind))
+        self.t0 = time.monotonic()
+
+    def outage(self, kind):
+        t = time.monotonic() - self.t0
+        return any(k == kind and s <= t < s + d for s, d, k in self.outages)
+
+    def latency(self, name):
+        return self.latency_ms.get(name, 0.0) / 1000.0
+
+    def chance(self, p):
+        return p > 0 and self.rng.random() < p
+
+    def mangle(self, line):
+        """Flip one byte of a reply line (bytes), as line noise would."""
+        if not line or not self.chance(self.garble):
+            return line
+        i = self.rng.randrange(len(line))
+        return line[:i] + bytes([line[i] ^ (1 << self.rng.randrange(7))]) + line[i + 1:]
+
+
+class Esp01:
+    def __init__(self, transport, server, faults, echo=True, log=None):
+        self.io = transport
+        self.server = server
+        self.faults = faults
+        self.echo = echo
+        self.log = log
+        self.baud = ESP_BAUD_DEFAULT
+        self.rx = b""
+        self.pending = []          # (due_time, bytes) replies waiting out their latency
+        self.wifi = False
+        self.conn = None
+        self.passthrough_mode = False  # AT+CIPMODE=1
+        self.data_mode = False         # inside "AT+CIPSEND" pass-through
+        self.send_left = 0             # bytes still expected after "AT+CIPSEND=n"
+        self.last_rx_time = 0.0
+        self.escape_held = b""         # '+' bytes held back in data mode while they may be "+++"
+        self.escape_start = 0.0        # arrival of the first of them
+        self.escape_at = None          # "+++" complete: command mode once this passes in silence
+        self.stats = {"commands": {}, "requests": 0, "replies": 0, "dropped": 0, "garbled": 0,
+                      "send_fail": 0, "stalled": 0, "closed_by_outage": 0, "power_cycles": 0, "bursts": 0,
+                      "tx_bytes": 0, "entry_latency_ms": []}
+        self.request_start = None
+
+    # replies ------------------------------------------------------------------
+    def reply(self, *lines, delay=0.0, raw=False):
+        due = time.monotonic() + delay
+        for line in lines:
+            data = line if raw else line.encode() + b"\r\n"
+            self.pending.append((due, data))
+
+    def flush_due(self):
+        now = time.monotonic()
+        keep = []
+        for due, data in self.pending:
+            if due > now:
+                keep.append((due, data))
+                continue
+            mangled = self.faults.mangle(data)
+            if mangled != data:
+                self.stats["garbled"] += 1
+            self.io.write(mangled)
+            self.stats["tx_bytes"] += len(mangled)
+            if self.log:
+                self.log.write("<- %r\n" % mangled)
+        self.pending = keep
+
+    # main loop ----------------------------------------------------------------
+    def step(self):
+        data = self.io.read()
+        now = time.monotonic()
+        if data:
+            quiet = now - self.last_rx_time
+            self.last_rx_time = now
+            if self.log:
+                self.log.write("-> %r\n" % data)
+            if self.baud != ESP_BAUD_DEFAULT and not self.data_mode and not self.send_left and self.looks_misframed(data):
+                # the sketch power-cycled the module (we cannot see CH_PD): back to the boot rate
+                self.stats["power_cycles"] += 1
+                self.reset()
+                self.rx = b""
+                return
+            self.feed(data, quiet)
+        if self.wifi and self.faults.outage("wifi"):
+            self.wifi = False
+            if self.conn:
+                self.stats["closed_by_outage"] += 1
+                self.close_link()
+                self.data_mode = False
+                self.reply("CLOSED")
+            self.reply("WIFI DISCONNECT")
+        if self.escape_held and not self.escape_at and now - self.escape_start > 1.0:
+            # never became "+++": they were data after all
+            self.forward(self.take_escape_held())
+        if self.escape_at and now >= self.escape_at:
+            # "+++" followed by a quiet second: back to command mode (no reply, link stays up)
+            self.escape_held, self.escape_at = b"", None
+            self.data_mode = False
+        self.poll_connection()
+        self.flush_due()
+
+    def feed(self, data, quiet=0.0):
+        if self.faults.outage("mute"):
+            return
+        if self.data_mode:
+            self.feed_data(data, quiet)
+            return
+        if self.send_left:
+            chunk, data = data[:self.send_left], data[self.send_left:]
+            self.send_left -= len(chunk)
+            self.rx += chunk
+            if not self.send_left:
+                payload, self.rx = self.rx, b""
+                self.finish_cipsend(payload)
+            if not data:
+                return
+        self.rx += data
+        while b"\r\n" in self.rx:
+            line, self.rx = self.rx.split(b"\r\n", 1)
+            self.command(line.decode("latin-1").strip())
+            if self.send_left or self.data_mode:
+                rest, self.rx = self.rx, b""
+                if rest:
+                    self.feed(rest)
+                return
+
+    def feed_data(self, data, quiet):
+        # "+++" may arrive in any number of reads: the '+' bytes are held back while they can still
+        # be the escape. The first needs >= 1 s of silence before it; any other byte (or a fourth
+        # '+') makes them data again, and the second of silence after is checked in step()
+        now = time.monotonic()
+        out = b""
+        for i in range(len(data)):
+            byte = data[i:i + 1]
+            guarded = i == 0 and quiet >= 0.9
+            if byte == b"+" and len(self.escape_held) < 3 and (self.escape_held or guarded):
+                if not self.escape_held:
+                    self.escape_start = now
+                self.escape_held += byte
+                if len(self.escape_held) == 3:
+                    self.escape_at = now + 1.0
+                continue
+            out += self.take_escape_held() + byte
+        if out:
+            self.forward(out)
+
+    def take_escape_held(self):
+        held, self.escape_held, self.escape_at = self.escape_held, b"", None
+        return held
+
+    @staticmethod
+    def looks_misframed(data):
+        return any(b >= 0x80 or (b < 0x20 and b not in (0x0D, 0x0A)) for b in data)
+
+    def count(self, name):
+        self.stats["commands"][name] = self.stats["commands"].get(name, 0) + 1
+
+    def command(self, line):
+        if not line:
+            return
+        m = re.match(r"AT\+?([A-Z_]*)(.*)", line)
+        name = (m.group(1) or "AT") if m else "?"
+        self.count(name)
+        if self.echo:
+            self.reply(line)
+        if self.faults.chance(self.faults.drop):
+            self.stats["dropped"] += 1
+            return
+        handler = getattr(self, "cmd_" + name.lower(), None)
+        if line in ("ATE0", "ATE1"):
+            self.echo = line == "ATE1"
+            self.reply("", "OK")
+        elif handler is None:
+            self.reply("", "ERROR")
+        else:
+            handler(m.group(2))
+
+    # AT commands --------------------------------------------------------------
+    def cmd_at(self, arg):
+        self.reply("", "OK", delay=self.faults.latency("AT"))
+
+    def cmd_rst(self, arg):
+        self.reply("", "OK")
+        self.reset()
+        self.reply("", "ready", delay=0.5)
+
+    def reset(self):
+        self.wifi = False
+        self.close_link()
+        self.passthrough_mode = False
+        self.data_mode = False
+        self.send_left = 0
+        self.escape_held, self.escape_at = b"", None
+        self.set_baud(ESP_BAUD_DEFAULT)
+
+    def cmd_cwmode(self, arg):
+        self.reply("", "OK")
+
+    def cmd_cwjap(self, arg):
+        delay = self.faults.latency("CWJAP") or 2.0
+        if self.faults.outage("wifi"):
+            self.reply("+CWJAP:3", "", "FAIL", delay=delay)
+            return
+        self.wifi = True
+        self.reply("WIFI CONNECTED", delay=delay / 2)
+        self.reply("WIFI GOT IP", "", "OK", delay=delay)
+
+    def cmd_uart_cur(self, arg):
+        baud = int(arg.lstrip("=").split(",")[0])
+        self.reply("", "OK")
+        self.flush_all()
+        time.sleep(0.01)
+        self.set_baud(baud)
+
+    cmd_uart_def = cmd_uart_cur
+
+    def set_baud(self, baud):
+        self.baud = baud
+        self.io.set_baud(baud)
+
+    def flush_all(self):
+        for _, data in self.pending:
+            self.io.write(data)
+            self.stats["tx_bytes"] += len(data)
+        self.pending = []
+
+    def cmd_cipmode(self, arg):
+        self.passthrough_mode = arg.strip("=") == "1"
+        self.reply("", "OK")
+
+    def cmd_cipstart(self, arg):
+        delay = self.faults.latency("CIPSTART")
+        if self.conn:
+            self.reply("ALREADY CONNECTED", "", "ERROR", delay=delay)
+            return
+        if not self.wifi or self.faults.outage("wifi"):
+            self.reply("", "ERROR", delay=delay)
+            return
+        if self.faults.outage("dns"):
+            self.reply("DNS FAIL", "", "ERROR", delay=delay)
+            return
+        parts = [p.strip('"') for p in arg.lstrip("=").split(",")]
+        try:
+            self.conn = self.server.connect(parts[1], int(parts[2]))
+        except OSError:
+            self.reply("", "ERROR", delay=delay)
+            return
+        self.request_start = time.monotonic()
+        self.reply("CONNECT", "", "OK", delay=delay)
+
+    def cmd_cipsend(self, arg):
+        if not self.conn:
+            self.reply("link is not valid", "", "ERROR")
+            return
+        if arg.startswith("="):
+            self.send_left = int(arg[1:])
+            self.reply("", "OK")
+            self.reply(b"> ", raw=True)
+        elif self.passthrough_mode:
+            self.data_mode = True
+            self.reply("", "OK")
+            self.reply(b">", raw=True)
+        else:
+            self.reply("", "ERROR")
+
+    def cmd_cipclose(self, arg):
+        if self.conn:
+            self.close_link()
+            self.reply("CLOSED", "", "OK")
+        else:
+            self.reply("", "ERROR")
+
+    # data path ----------------------------------------------------------------
+    def finish_cipsend(self, payload):
+        self.reply("", "Recv %d bytes" % len(payload))
+        if self.faults.chance(self.faults.send_fail):
+            self.stats["send_fail"] += 1
+            self.reply("", "SEND FAIL", delay=self.faults.latency("SEND"))
+            return
+        self.reply("", "SEND OK", delay=self.faults.latency("SEND"))
+        self.forward(payload)
+
+    def forward(self, payload):
+        if not self.conn:
+            return
+        self.stats["requests"] += payload.count(b"HTTP/1.1\r\n")
+        if self.request_start is None:
+            self.request_start = time.monotonic()
+        if self.faults.outage("stall"):
+            self.stats["stalled"] += 1
+            return
+        self.conn.send(payload)
+
+    def poll_connection(self):
+        if not self.conn:
+            return
+        data = self.conn.recv()
+        if data:
+            self.stats["replies"] += 1
+            delay = self.faults.latency("HTTP")
+            m = re.search(rb"\r\n\r\n(\d+)", data)
+            if m and int(m.group(1)) > 0 and self.request_start is not None:
+                self.stats["entry_latency_ms"].append(
+                    round((time.monotonic() + delay - self.request_start) * 1000, 1))
+            self.request_start = None
+            if self.data_mode:
+                self.reply(data, raw=True, delay=delay)
+            else:
+                self.reply(b"\r\n+IPD,%d:" % len(data) + data, raw=True, delay=delay)
+        if self.conn and self.conn.closed_by_peer:
+            self.close_link()
+            self.data_mode = False
+            self.reply("CLOSED", delay=self.faults.latency("HTTP"))
+
+    def idle(self):
+        return not self.conn and not self.data_mode and not self.send_left and not self.pending
+
+    def burst(self, nbytes):
+        """Send nbytes of filler lines in one write. They carry none of the words the driver acts
+        on and stay under its 64-byte line buffer."""
+        data = b""
+        while len(data) < nbytes:
+            data += ("burst %05d " % (len(data) // 32)).ljust(30, ".").encode() + b"\r\n"
+        self.stats["bursts"] += 1
+        self.reply(data[:nbytes], raw=True)
+        self.flush_due()
+
+    def close_link(self):
+        if self.conn:
+            self.conn.close()
+        self.conn = None
+
+    def summary(self):
+        s = dict(self.stats)
+        lat = sorted(s.pop("entry_latency_ms"))
+        s["entries"] = len(lat)
+        if lat:
+            s["entry_latency_ms"] = {"min": lat[0], "median": lat[len(lat) // 2],
+                                     "p95": lat[min(len(lat) - 1, int(len(lat) * 0.95))], "max": lat[-1]}
+        return s
+
+
+def build_arg_parser():
+    ap = argparse.ArgumentParser(description=__doc__, formatter_class=argparse.RawDescriptionHelpFormatter)
+    where = ap.add_mutually_exclusive_group(required=True)
+    where.add_argument("--port", help="USB-UART wired in place of the ESP01")
+    where.add_argument("--pty", action="store_true", help="serve on a pseudo-terminal")
+    ap.add_argument("--server", help="HOST:PORT to forward TCP to (default: built-in stand-in)")
+    ap.add_argument("--rate-limit", type=float, default=0.0, help="built-in server: seconds between entries")
+    ap.add_argument("--seed", type=int, default=1)
+    ap.add_argument("--drop", type=float, default=0.0, help="probability a command gets no reply")
+    ap.add_argument("--garble", type=float, default=0.0, help="probability a reply line has a flipped bit")
+    ap.add_argument("--send-fail", type=float, default=0.0, help="probability of SEND FAIL")
+    ap.add_argument("--latency", help="per-step delays in ms, e.g. AT=5,CWJAP=3000,CIPSTART=250,SEND=40,HTTP=400")
+    ap.add_argument("--outage", action="append", help="START_S:DURATION_S:wifi|dns|stall|mute")
+    ap.add_argument("--no-echo", action="store_true", help="start with ATE0")
+    ap.add_argument("--log", action="store_true", help="trace all traffic to stderr")
+    ap.add_argument("--stats", help="write the summary as JSON to this file")
+    ap.add_argument("--duration", type=float, default=0.0, help="stop after this many seconds")
+    ap.add_argument("--burst", metavar="BYTES:EVERY_S", help="filler bursts while the link is idle")
+    return ap
+
+
+def main():
+    args = build_arg_parser().parse_args()
+    if args.pty:
+        transport = PtyTransport()
+        print("ESP01 emulator on %s" % transport.path, file=sys.stderr)
+    else:
+        transport = SerialTransport(args.port, ESP_BAUD_DEFAULT)
+    server = TcpServer(args.server) if args.server else BuiltinThingSpeak(args.rate_limit)
+    esp = Esp01(transport, server, Faults(args), echo=not args.no_echo, log=sys.stderr if args.log else None)
+    burst_bytes, burst_every = (int(args.burst.split(":")[0]), float(args.burst.split(":")[1])) if args.burst else (0, 0)
+    t0 = next_burst = time.monotonic()
+    try:
+        while not args.duration or time.monotonic() - t0 < args.duration:
+            esp.step()
+            if burst_bytes and time.monotonic() >= next_burst and esp.idle():
+                esp.burst(burst_bytes)
+                next_burst = time.monotonic() + burst_every
+            time.sleep(0.001)
+    except KeyboardInterrupt:
+        pass
+    summary = esp.summary()
+    print(json.dumps(summary, indent=2), file=sys.stderr)
+    if args.stats:
+        with open(args.stats, "w") as f:
+            json.dump(summary, f, indent=2)
+
+
+if __name__ == "__main__":
+    main()
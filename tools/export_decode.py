@@ -0,0 +1,193 @@
+#!/usr/bin/env python3
+"""Decode the binary "export" stream of MainController (see MainController/SerialExport.h).
+
+Live, over the board's USB serial port (needs pyserial):
+    python3 export_decode.py --port /dev/ttyUSB0            # readings not exported yet
+    python3 export_decode.py --port /dev/ttyUSB0 --all      # every stored reading
+    python3 export_decode.py --port /dev/ttyUSB0 --compare  # records/s: export all vs text dump
+From a capture of the raw serial bytes:
+    python3 export_decode.py --file capture.bin
+
+Readings are written as CSV to stdout. Transfer statistics go to stderr.
+"""
+
+import argparse
+import struct
+import sys
+import time
+
+SYNC = 0xA5
+FLAG_ALERT, FLAG_IN_PROGRESS, FLAG_PARTIAL, FLAG_WARMUP = 0x01, 0x02, 0x04, 0x08
+
+
+def crc16_mcrf4xx(data, crc=0xFFFF):
+    """avr-libc _crc_ccitt_update, started at 0xFFFF."""
+    for b in data:
+        b ^= crc & 0xFF
+        b = (b ^ (b << 4)) & 0xFF
+        crc = ((b << 8) | (crc >> 8)) ^ (b >> 4) ^ (b << 3)
+        crc &= 0xFFFF
+    return crc
+
+
+class FrameParser:
+    """Feed bytes, get (type, payload) for every frame with a good CRC. Text around the
+    frames (the "(USER)" prefix, other log lines) is skipped."""
+
+    def __init__(self):
+        self.buf = bytearray()
+        self.crc_errors = 0
+
+    def feed(self, data):
+        self.buf += data
+        frames = []
+        while True:
+            i = self.buf.find(bytes([SYNC]))
+            if i < 0:
+                self.buf.clear()
+                break
+            del self.buf[:i]
+            if len(self.buf) < 3:
+                break
+            ftype, length = self.buf[1], self.buf[2]
+            end = 3 + length + 2
+            if len(self.buf) < end:
+                break
+            body = bytes(self.buf[1:3 + length])
+            (crc,) = struct.unpack_from("<H", self.buf, 3 + length)
+            if crc16_mcrf4xx(body) == crc:
+                frames.append((chr(ftype), body[2:]))
+                del self.buf[:end]
+            else:
+                # not a frame after all (or damaged): resync after this byte
+                self.crc_errors += 1
+                del self.buf[:1]
+        return frames
+
+
+def decode_reading(raw):
+    duration_ms, ts, seq, flags_ch, sub_events = struct.unpack("<IIHBB", raw)
+    return {
+        "seq": seq,
+        "ts": ts,
+        "duration_ms": duration_ms,
+        "flags": flags_ch & 0x0F,
+        "channel": flags_ch >> 4,
+        "sub_events": sub_events,
+    }
+
+
+class Export:
+    """One export: header fields plus the decoded readings."""
+
+    def __init__(self):
+        self.header = None
+        self.readings = []
+        self.done = False
+
+    def on_frame(self, ftype, payload):
+        if ftype == "H":
+            version, rec_bytes, count, now_ms, boot_seq = struct.unpack("<BBBIH", payload)
+            if version != 1 or rec_bytes != 12:
+                raise ValueError("unsupported export format %d/%d" % (version, rec_bytes))
+            self.header = {"count": count, "now_ms": now_ms, "boot_seq": boot_seq}
+            self.readings = []
+        elif ftype == "R" and self.header is not None:
+            for i in range(0, len(payload), 12):
+                self.readings.append(decode_reading(payload[i:i + 12]))
+        elif ftype == "E" and self.header is not None:
+            self.done = True
+            if payload[0] != len(self.readings):
+                print("warning: end frame says %d readings, got %d" % (payload[0], len(self.readings)),
+                      file=sys.stderr)
+
+
+def this_boot(seq, boot_seq, next_seq_guess):
+    # same test as EEPROMStorage::recordedThisBoot, with the newest exported seq + 1 as nextSeq
+    return ((seq - boot_seq) & 0xFFFF) < ((next_seq_guess - boot_seq) & 0xFFFF)
+
+
+def write_csv(export, host_time, out):
+    hdr = export.header
+    next_seq = (max((r["seq"] for r in export.readings), default=hdr["boot_seq"]) + 1) & 0xFFFF
+    out.write("seq,ts_ms,duration_ms,flags,channel,sub_events,this_boot,wall_start\n")
+    for r in export.readings:
+        mine = this_boot(r["seq"], hdr["boot_seq"], next_seq)
+        wall = ""
+        if mine and host_time is not None:
+            # millis() of this boot -> host clock
+            wall = time.strftime("%Y-%m-%d %H:%M:%S",
+                                 time.localtime(host_time - (hdr["now_ms"] - r["ts"]) / 1000.0))
+        out.write("%d,%d,%d,%d,%d,%d,%d,%s\n" % (r["seq"], r["ts"], r["duration_ms"], r["flags"],
+                                                r["channel"], r["sub_events"], int(mine), wall))
+
+
+def run_command(port, command, until, timeout=10.0):
+    """Send a command, read until until(chunk_so_far) is true. Returns (bytes, seconds)."""
+    port.reset_input_buffer()
+    t0 = time.monotonic()
+    port.write((command + "\n").encode())
+    data = bytearray()
+    while time.monotonic() - t0 < timeout:
+        chunk = port.read(port.in_waiting or 1)
+        if chunk:
+            data += chunk
+            if until(data):
+                break
+    return bytes(data), time.monotonic() - t0
+
+
+def export_live(port, export_all):
+    parser, export = FrameParser(), Export()
+
+    def done(data):
+        for f in parser.feed(data[done.seen:]):
+            export.on_frame(*f)
+        done.seen = len(data)
+        return export.done
+    done.seen = 0
+
+    data, secs = run_command(port, "export all" if export_all else "export", done)
+    if not export.done:
+        raise SystemExit("no complete export received (%d bytes)" % len(data))
+    return export, len(data), secs, parser.crc_errors
+
+
+def main():
+    ap = argparse.ArgumentParser(description=__doc__, formatter_class=argparse.RawDescriptionHelpFormatter)
+    src = ap.add_mutually_exclusive_group(required=True)
+    src.add_argument("--port", help="serial port of the board")
+    src.add_argument("--file", help="raw capture to decode")
+    ap.add_argument("--baud", type=int, default=115200)
+    ap.add_argument("--all", action="store_true", help="export every stored reading, not just new ones")
+    ap.add_argument("--compare", action="store_true", help="time 'export all' against the text 'dump'")
+    args = ap.parse_args()
+
+    if args.file:
+        parser, export = FrameParser(), Export()
+        with open(args.file, "rb") as f:
+            for frame in parser.feed(f.read()):
+                export.on_frame(*frame)
+        if export.header is None:
+            raise SystemExit("no export header found")
+        write_csv(export, None, sys.stdout)
+        return
+
+    import serial  # pyserial
+    with serial.Serial(args.port, args.baud, timeout=0.05) as port:
+        time.sleep(2.0)  # opening the port resets the Uno
+        port.reset_input_buffer()
+        export, nbytes, secs, crc_errors = export_live(port, args.all or args.compare)
+        n = len(export.readings)
+        print("export: %d readings, %d bytes in %.3f s = %.0f readings/s (%d CRC errors)"
+              % (n, nbytes, secs, n / secs if secs else 0, crc_errors), file=sys.stderr)
+        if args.compare:
+            # the dump ends with the empty line processSerialCommands prints after every command
+            data, dsecs = run_command(port, "dump", lambda d: d.count(b"\n") >= n + 2)
+            print("dump:   %d readings, %d bytes in %.3f s = %.0f readings/s"
+                  % (n, len(data), dsecs, n / dsecs if dsecs else 0), file=sys.stderr)
+        write_csv(export, time.time(), sys.stdout)
+
+
+if __name__ == "__main__":
+    main()
@@ -0,0 +1,211 @@
+#!/usr/bin/env python3
+"""Host side of the binary protocol in MainController/BinaryLink.h.
+
+    python3 motionlink.py --port /dev/ttyUSB0 status
+    python3 motionlink.py --port /dev/ttyUSB0 counters
+    python3 motionlink.py --port /dev/ttyUSB0 --port /dev/ttyUSB1 poll     # one line per device
+    python3 motionlink.py --port /dev/ttyUSB0 watch                        # live events
+    python3 motionlink.py --port /dev/ttyUSB0 send | esp-on | esp-off
+
+Frames are 0x00 | COBS(type, tag, data, crc16) | 0x00 and can share the port with the text
+UI and its log lines, which are skipped. Needs pyserial for real ports.
+"""
+
+import argparse
+import struct
+import sys
+import time
+
+from export_decode import crc16_mcrf4xx
+
+MSG_PING, MSG_GET_STATUS, MSG_GET_COUNTERS, MSG_COMMAND = 0x01, 0x02, 0x03, 0x04
+MSG_REPLY, MSG_NAK = 0x80, 0xFF
+MSG_EVENT_READING, MSG_EVENT_ALERT = 0x90, 0x91
+CMD_SEND_NOW, CMD_ESP_ON, CMD_ESP_OFF, CMD_SUBSCRIBE, CMD_UNSUBSCRIBE = 1, 2, 3, 4, 5
+
+ESP_STATES = ["OFF", "BOOTING", "READY", "SENDING", "ERROR"]
+PIR_STATES = ["OFF", "IDLE", "MOTION", "WARMUP"]
+
+# reply layouts (little endian), names in the order BinaryLink.h / MainController.ino write them
+STATUS_FMT = "<IBBBBBBIIIIHI"
+STATUS_FIELDS = ["millis", "esp_state", "pir_state", "stored", "unsent", "unexported", "last_send_ok",
+                 "last_send_at", "alert_latency_ms", "event_latency_ms", "esp_state_since",
+                 "latency_n", "latency_p95_ms"]
+COUNTERS_FMT = "<HHHHIHBHIHHHBIHIIH"
+COUNTERS_FIELDS = ["sends_attempted", "sends_ok", "sends_failed", "retries", "bytes_sent",
+                   "eeprom_writes", "queue_high_water", "esp_reboots", "max_event_to_upload_ms",
+                   "rx_overflows", "rx_truncated_lines", "esp_recoveries", "watchdog_resets", "rx_bytes",
+                   "fields_truncated", "eeprom_reads", "eeprom_read_bytes", "readings_drained"]
+READING_FMT = "<IIHBBB"
+READING_FIELDS = ["duration_ms", "ts", "seq", "flags", "channel", "sub_events"]
+
+
+def cobs_encode(data):
+    out, block = bytearray(), bytearray()
+    for b in data:
+        if b == 0:
+            out += bytes([len(block) + 1]) + block
+            block = bytearray()
+        else:
+            block.append(b)
+            if len(block) == 254:
+                out += bytes([255]) + block
+                block = bytearray()
+    out += bytes([len(block) + 1]) + block
+    return bytes(out)
+
+
+def cobs_decode(data):
+    out, i = bytearray(), 0
+    while i < len(data):
+        code = data[i]
+        if code == 0 or i + code > len(data):
+            raise ValueError("bad COBS block")
+        out += data[i + 1:i + code]
+        i += code
+        if code != 0xFF and i < len(data):
+            out.append(0)
+    return bytes(out)
+
+
+def encode_frame(msg):
+    crc = crc16_mcrf4xx(msg)
+    return b"\x00" + cobs_encode(msg + struct.pack("<H", crc)) + b"\x00"
+
+
+class FrameReader:
+    """Split a byte stream on 0x00 and keep the segments that decode with a good CRC."""
+
+    def __init__(self):
+        self.buf = bytearray()
+        self.rejected = 0
+
+    def feed(self, data):
+        self.buf += data
+        msgs = []
+        while True:
+            i = self.buf.find(b"\x00")
+            if i < 0:
+                break
+            seg = bytes(self.buf[:i])
+            del self.buf[:i + 1]
+            if not seg:
+                continue
+            try:
+                raw = cobs_decode(seg)
+            except ValueError:
+                self.rejected += 1
+                continue
+            if len(raw) >= 4 and crc16_mcrf4xx(raw[:-2]) == struct.unpack("<H", raw[-2:])[0]:
+                msgs.append(raw[:-2])
+            else:
+                self.rejected += 1  # a text line, or a damaged frame
+        return msgs
+
+
+def unpack(fmt, fields, data):
+    # fields appended in later firmware are left out for a board that does not send them yet
+    while len(fmt) > 1 and struct.calcsize(fmt) > len(data):
+        fmt = fmt[:-1]
+    return dict(zip(fields, struct.unpack(fmt, data[:struct.calcsize(fmt)])))
+
+
+class Device:
+    def __init__(self, port):
+        self.port = port
+        self.reader = FrameReader()
+        self.tag = 0
+        self.events = []
+
+    def request(self, mtype, args=b"", timeout=1.0):
+        self.tag = self.tag % 255 + 1
+        self.port.write(encode_frame(bytes([mtype, self.tag]) + args))
+        t0 = time.monotonic()
+        while time.monotonic() - t0 < timeout:
+            for msg in self.reader.feed(self.port.read(self.port.in_waiting or 1)):
+                if msg[0] in (MSG_EVENT_READING, MSG_EVENT_ALERT):
+                    self.events.append(msg)
+                elif msg[1] == self.tag:
+                    if msg[0] == MSG_NAK:
+                        raise RuntimeError("device rejected message type 0x%02x" % msg[2])
+                    return msg[2:], time.monotonic() - t0
+        raise TimeoutError("no reply to message 0x%02x" % mtype)
+
+    def status(self):
+        data, rtt = self.request(MSG_GET_STATUS)
+        st = unpack(STATUS_FMT, STATUS_FIELDS, data)
+        st["esp_state"] = ESP_STATES[st["esp_state"]] if st["esp_state"] < len(ESP_STATES) else st["esp_state"]
+        st["pir_state"] = PIR_STATES[st["pir_state"]] if st["pir_state"] < len(PIR_STATES) else st["pir_state"]
+        return st, rtt
+
+    def counters(self):
+        data, rtt = self.request(MSG_GET_COUNTERS)
+        return unpack(COUNTERS_FMT, COUNTERS_FIELDS, data), rtt
+
+    def command(self, cmd):
+        data, _ = self.request(MSG_COMMAND, bytes([cmd]))  # esp-on only starts the boot; poll status for READY
+        return data[1] == 1
+
+    def watch(self, out):
+        self.command(CMD_SUBSCRIBE)
+        try:
+            while True:
+                for msg in self.events + self.reader.feed(self.port.read(self.port.in_waiting or 1)):
+                    if msg[0] == MSG_EVENT_READING:
+                        out.write("reading %s\n" % unpack(READING_FMT, READING_FIELDS, msg[2:]))
+                    elif msg[0] == MSG_EVENT_ALERT:
+                        ts, ch = struct.unpack("<IB", msg[2:7])
+                        out.write("alert ts=%d channel=%d\n" % (ts, ch))
+                    out.flush()
+                self.events = []
+        finally:
+            self.command(CMD_UNSUBSCRIBE)
+
+
+def main():
+    ap = argparse.ArgumentParser(description=__doc__, formatter_class=argparse.RawDescriptionHelpFormatter)
+    ap.add_argument("--port", action="append", required=True, help="serial port (repeat for several devices)")
+    ap.add_argument("--baud", type=int, default=115200)
+    ap.add_argument("--no-reset-wait", action="store_true", help="port does not reset the board on open")
+    ap.add_argument("action", choices=["ping", "status", "counters", "poll", "watch", "send", "esp-on", "esp-off"])
+    args = ap.parse_args()
+
+    import serial  # pyserial
+    ports = [serial.Serial(p, args.baud, timeout=0.01) for p in args.port]
+    if not args.no_reset_wait:
+        time.sleep(2.0)  # opening the port resets an Uno
+    devices = [Device(p) for p in ports]
+
+    if args.action == "watch":
+        devices[0].watch(sys.stdout)
+    elif args.action in ("send", "esp-on", "esp-off"):
+        cmd = {"send": CMD_SEND_NOW, "esp-on": CMD_ESP_ON, "esp-off": CMD_ESP_OFF}[args.action]
+        for name, dev in zip(args.port, devices):
+            print("%s: %s" % (name, "ok" if dev.command(cmd) else "rejected"))
+    else:
+        t0 = time.monotonic()
+        for name, dev in zip(args.port, devices):
+            if args.action == "ping":
+                data, rtt = dev.request(MSG_PING)
+                version, millis = struct.unpack("<BI", data[:5])
+                print("%s: protocol %d, up %.1f s, rtt %.1f ms" % (name, version, millis / 1000.0, rtt * 1000))
+            elif args.action == "status":
+                st, rtt = dev.status()
+                print("%s: %s" % (name, st))
+            elif args.action == "counters":
+                c, rtt = dev.counters()
+                print("%s: %s" % (name, c))
+            else:  # poll: status + counters, one line per device
+                st, _ = dev.status()
+                c, _ = dev.counters()
+                print("%s esp=%s pir=%s stored=%d unsent=%d ok=%d/%d reboots=%d recoveries=%d p95=%dms"
+                      % (name, st["esp_state"], st["pir_state"], st["stored"], st["unsent"],
+                         c["sends_ok"], c["sends_attempted"], c["esp_reboots"], c["esp_recoveries"],
+                         st["latency_p95_ms"]))
+        print("%d device(s) in %.1f ms" % (len(devices), (time.monotonic() - t0) * 1000), file=sys.stderr)
+    for p in ports:
+        p.close()
+
+
+if __name__ == "__main__":
+    main()
@@ -0,0 +1,140 @@
+#!/usr/bin/env python3
+"""RAM budget check for the sketch: an Uno has 2048 bytes of SRAM for globals, heap and stack.
+
+    python3 ram_budget.py                                  # string literals left in SRAM
+    python3 ram_budget.py --elf build/MainController.ino.elf
+    arduino-cli compile -b arduino:avr:uno --output-dir build ../MainController && \\
+        python3 ram_budget.py --elf build/MainController.ino.elf --reserve 700
+
+Without --elf the sources are scanned for string literals that avr-gcc copies into SRAM at
+start-up: every literal not inside F(), PSTR(), sizeof(), static_assert() or asm(). Identical
+literals are counted once (the linker merges them). This needs no toolchain and catches the
+usual regression, a print("...") without F().
+
+With --elf the linked image is measured: .data (initialised globals and the literals above),
+.bss and .noinit are static RAM, and what is left of the 2048 bytes must cover the stack and
+the String heap (pendingPayload holds a whole request). The check fails when less than
+--reserve bytes are left. Stdlib only.
+"""
+
+import argparse
+import os
+import re
+import struct
+import sys
+
+SRAM = 2048
+SKETCH_DIR = os.path.join(os.path.dirname(os.path.abspath(__file__)), os.pardir, "MainController")
+FLASH_WRAPPERS = ("F", "PSTR", "sizeof", "static_assert", "asm", "volatile", "section")
+STATIC_SECTIONS = (".data", ".bss", ".noinit")
+
+TOKEN = re.compile(r'//[^\n]*|/\*.*?\*/|"(?:[^"\\\n]|\\.)*"|\'(?:[^\'\\\n]|\\.)*\'', re.S)
+
+
+def literal_bytes(lit):
+    """Length of a C string literal in bytes, without the terminating zero."""
+    body = lit[1:-1]
+    return len(re.sub(r'\\(x[0-9a-fA-F]+|[0-7]{1,3}|.)', "x", body))
+
+
+def wrapper_of(text, pos):
+    """Name of the call whose parentheses enclose the literal at pos, or None at top level."""
+    depth = 0
+    i = pos
+    while i > 0:
+        i -= 1
+        c = text[i]
+        if c == '"' or c == "'":
+            # skip back over another literal
+            j = i - 1
+            while j > 0 and not (text[j] == c and text[j - 1] != "\\"):
+                j -= 1
+            i = j
+        elif c == ")":
+            depth += 1
+        elif c == "(":
+            if depth == 0:
+                m = re.search(r"(\w+)\s*$", text[:i])
+                return m.group(1) if m else None
+            depth -= 1
+        elif c in ";{}":
+            return None
+    return None
+
+
+def scan_sources(path):
+    """{literal: [file:line, ...]} for every literal that ends up in SRAM."""
+    found = {}
+    for name in sorted(os.listdir(path)):
+        if not name.endswith((".h", ".ino", ".cpp")):
+            continue
+        with open(os.path.join(path, name), newline="") as f:
+            text = f.read()
+        for m in TOKEN.finditer(text):
+            tok = m.group(0)
+            if not tok.startswith('"'):
+                continue
+            line_start = text.rfind("\n", 0, m.start()) + 1
+            if text[line_start:m.start()].lstrip().startswith("#"):
+                continue  # #include / #define: counted where the macro is used
+            if wrapper_of(text, m.start()) in FLASH_WRAPPERS:
+                continue
+            line = text.count("\n", 0, m.start()) + 1
+            found.setdefault(tok, []).append("%s:%d" % (name, line))
+    return found
+
+
+def elf_sections(path):
+    """{name: size} of the sections of a 32-bit little-endian ELF file."""
+    with open(path, "rb") as f:
+        data = f.read()
+    if data[:4] != b"\x7fELF" or data[4] != 1:
+        raise ValueError("%s is not a 32-bit ELF file" % path)
+    shoff, = struct.unpack_from("<I", data, 0x20)
+    shentsize, shnum, shstrndx = struct.unpack_from("<HHH", data, 0x2E)
+    headers = [struct.unpack_from("<IIIIIIIIII", data, shoff + k * shentsize) for k in range(shnum)]
+    strtab = headers[shstrndx][4]
+    out = {}
+    for h in headers:
+        end = data.index(b"\0", strtab + h[0])
+        out[data[strtab + h[0]:end].decode()] = h[5]
+    return out
+
+
+def main():
+    ap = argparse.ArgumentParser(description=__doc__, formatter_class=argparse.RawDescriptionHelpFormatter)
+    ap.add_argument("--sources", default=SKETCH_DIR, help="sketch directory to scan")
+    ap.add_argument("--literal-budget", type=int, default=256,
+                    help="most bytes of string literals allowed in SRAM (default 256)")
+    ap.add_argument("--elf", help="linked sketch (arduino-cli compile --output-dir)")
+    ap.add_argument("--reserve", type=int, default=600,
+                    help="SRAM that must stay free for stack and heap (default 600)")
+    ap.add_argument("-v", "--verbose", action="store_true", help="list every literal")
+    args = ap.parse_args()
+
+    ok = True
+    found = scan_sources(args.sources)
+    total = sum(literal_bytes(lit) + 1 for lit in found)
+    if args.verbose:
+        for lit, where in sorted(found.items(), key=lambda kv: -literal_bytes(kv[0])):
+            print("%5d  %-40s %s" % (literal_bytes(lit) + 1, lit[:40], ", ".join(where[:3])))
+    print("string literals in SRAM: %d bytes in %d literals (budget %d)" % (total, len(found), args.literal_budget))
+    if total > args.literal_budget:
+        print("  too many: wrap print()/println() text in F() and snprintf() formats in PSTR()",
+              file=sys.stderr)
+        ok = False
+
+    if args.elf:
+        sizes = elf_sections(args.elf)
+        static = sum(sizes.get(s, 0) for s in STATIC_SECTIONS)
+        parts = "  ".join("%s %d" % (s, sizes.get(s, 0)) for s in STATIC_SECTIONS)
+        print("static RAM: %d of %d bytes (%s), %d left for stack and heap (reserve %d)"
+              % (static, SRAM, parts, SRAM - static, args.reserve))
+        if SRAM - static < args.reserve:
+            print("  over budget", file=sys.stderr)
+            ok = False
+    sys.exit(0 if ok else 1)
+
+
+if __name__ == "__main__":
+    main()
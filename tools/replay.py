@@ -0,0 +1,681 @@
+#!/usr/bin/env python3
+"""Replay PIR activity through a model of the sketch's event, storage and upload logic.
+
+    python3 replay.py --log "../output files/serial output.txt" --days 30
+    python3 replay.py --csv export.csv --days 7            # export_decode.py output (ts_ms, duration_ms)
+    python3 replay.py --poisson 40 --mean-duration 8 --days 30 --outage 86400:7200
+    python3 replay.py --bursty 20 --burst-rate 300 --burst-len 10 --quiet-len 120 --series depth.csv
+
+The sketch itself cannot run on the host (there is no host build of the Arduino core), so this is
+a model of it on a virtual clock, event by event, mirroring:
+  - MotionDetectorCore: merge gap, in-progress checkpoints, motion-start alerts, warm-up
+  - EEPROMStorage: the ring with its cloud (blocking) and export (lossy) cursors,
+    pushOrReplace, push refusing when full, and the header/record bytes behind each call,
+    written with update semantics so EEPROM writes and per-cell wear are byte-exact for
+    the same call sequence
+  - MainController loop()/ESP01Driver: alerts ahead of readings, THINGSPEAK_MIN_INTERVAL and
+    ALERT_MIN_INTERVAL sharing one timestamp (alerts also wait out ALERT_MIN_INTERVAL from
+    ThingSpeak's last reply), an entry id (and only that) taking the reading
+    off the queue, ThingSpeak's 15 s limit answering "0", error recovery after ESP_MAX_*_MS
+Timing of the ESP itself (join, request round trip) comes from parameters; measure them with
+esp01_emulator.py / thingspeak_server.py or on the real link. The Config defaults that mirror
+compiled-in settings are read from MainController.ino's consts and the headers' #defines when the
+tool starts, so they follow the sketch as it is edited.
+
+Reports queue depth over time, drops, EEPROM writes and wear, uploads and event-to-upload
+latency. A month of traffic replays in a few seconds.
+"""
+
+import argparse
+import bisect
+import json
+import os
+import random
+import re
+import sys
+import time
+from dataclasses import asdict, dataclass, fields
+
+FLAG_ALERT, FLAG_IN_PROGRESS, FLAG_PARTIAL, FLAG_WARMUP = 0x01, 0x02, 0x04, 0x08
+EEPROM_SIZE = 1024
+ADDR_READINGS = 16
+READING_BYTES = 12
+EEPROM_ENDURANCE = 100000
+
+SKETCH_DIR = os.path.join(os.path.dirname(os.path.abspath(__file__)), os.pardir, "MainController")
+# Used only when the sketch sources are not next to the tool (or a name is gone from them)
+SKETCH_FALLBACK = {
+    "EEPROM_MAX_ENTRIES": 10, "THINGSPEAK_MIN_INTERVAL": 20000, "ALERT_MIN_INTERVAL": 15000,
+    "ALERT_DEBOUNCE_MS": 0, "MERGE_GAP_MS": 5000, "CHECKPOINT_INTERVAL_MS": 60000,
+    "PIR_WARMUP_MS": 120000, "EXPORT_BLOCKING": False, "ESP_MAX_ERROR_MS": 30000,
+}
+
+
+def sketch_constants(path=SKETCH_DIR):
+    """The SKETCH_FALLBACK names as compiled: `const T NAME = value;` and `#define NAME value`."""
+    found = {}
+    for name in ("MainController.ino", "EEPROMStorage.h", "ESP01Driver.h"):
+        try:
+            with open(os.path.join(path, name)) as f:
+                text = f.read()
+        except OSError:
+            continue
+        for m in re.finditer(r"^\s*(?:const\s+[\w ]+?\s+(\w+)\s*=\s*([^;/]+);|#define\s+(\w+)\s+(\S+))",
+                             text, re.M):
+            key, raw = (m.group(1), m.group(2)) if m.group(1) else (m.group(3), m.group(4))
+            if key not in SKETCH_FALLBACK or key in found:
+                continue
+            raw = raw.strip()
+            if raw in ("true", "false"):
+                found[key] = raw == "true"
+            else:
+                try:
+                    found[key] = int(raw.rstrip("uUlL"), 0)
+                except ValueError:
+                    pass
+    missing = sorted(set(SKETCH_FALLBACK) - set(found))
+    if missing:
+        print("replay: %s not found under %s, using built-in defaults" % (", ".join(missing), path),
+              file=sys.stderr)
+    return dict(SKETCH_FALLBACK, **found)
+
+
+SKETCH = sketch_constants()
+
+
+@dataclass
+class Config:
+    # MainController.ino
+    max_entries: int = SKETCH["EEPROM_MAX_ENTRIES"]
+    min_interval_s: float = SKETCH["THINGSPEAK_MIN_INTERVAL"] / 1000.0
+    alert_min_interval_s: float = SKETCH["ALERT_MIN_INTERVAL"] / 1000.0
+    alerts: bool = True
+    alert_debounce_s: float = SKETCH["ALERT_DEBOUNCE_MS"] / 1000.0
+    merge_gap_s: float = SKETCH["MERGE_GAP_MS"] / 1000.0
+    checkpoint_interval_s: float = SKETCH["CHECKPOINT_INTERVAL_MS"] / 1000.0  # 0 = off
+    warmup_s: float = SKETCH["PIR_WARMUP_MS"] / 1000.0  # warm-up pulses dropped
+    export_blocking: bool = SKETCH["EXPORT_BLOCKING"]  # nothing exports in the model
+    # ESP01Driver.h
+    recovery_s: float = SKETCH["ESP_MAX_ERROR_MS"] / 1000.0  # ESP_MAX_BOOTING_MS is the same 30 s
+    # link and cloud (measured, not compiled in)
+    esp_on: bool = True               # ESP powered from the start (ESP_AUTO_ON or "esp on")
+    join_s: float = 6.0               # power-on to WIFI GOT IP
+    request_s: float = 2.5            # mean CIPSTART to entry id; each request draws 0.5..1.5x
+    request_fail_p: float = 0.0       # SEND FAIL / closed without entry id
+    server_rate_limit_s: float = 15.0  # ThingSpeak answers "0" inside this window
+
+
+class Storage:
+    """EEPROMStorage with a byte image of the EEPROM and update-semantics write counting."""
+
+    CURSOR_CLOUD, CURSOR_EXPORT = 0, 1
+
+    def __init__(self, max_entries, export_blocking):
+        self.max = max_entries
+        self.ee = bytearray(b"\xff" * EEPROM_SIZE)
+        self.wear = [0] * EEPROM_SIZE
+        self.head = self.count = 0
+        self.next_seq = 0
+        self.cursor = [0, 0]
+        self.lossy = [False, not export_blocking]
+        self.lost = [0, 0]
+        self.slots = [None] * max_entries  # decoded copy of each slot (duration, ts, seq, flags, sub_events)
+        for a, v in ((0, 0), (1, 0), (2, 4), (3, 0), (4, 0), (6, 0), (7, 0), (8, max_entries)):
+            self.ee[a] = v  # state after begin() on a fresh layout; not counted
+
+    def write_byte(self, addr, v):
+        if self.ee[addr] != v:
+            self.ee[addr] = v
+            self.wear[addr] += 1
+
+    def write_reading(self, index, r):
+        duration, ts, seq, flags, sub_events = r
+        addr = ADDR_READINGS + index * READING_BYTES
+        raw = (duration & 0xFFFFFFFF).to_bytes(4, "little") + (ts & 0xFFFFFFFF).to_bytes(4, "little") + \
+            (seq & 0xFFFF).to_bytes(2, "little") + bytes([flags & 0x0F, min(sub_events, 255)])
+        for i, b in enumerate(raw):
+            self.write_byte(addr + i, b)
+        self.slots[index] = r
+
+    def write_seq(self):
+        self.write_byte(3, self.next_seq & 0xFF)
+        self.write_byte(4, (self.next_seq >> 8) & 0xFF)
+
+    def push(self, duration, ts, flags, sub_events=1):
+        if self.count >= self.max and not self.overrun_lossy():
+            return False
+        r = (duration, ts, self.next_seq, flags, sub_events)
+        self.next_seq = (self.next_seq + 1) & 0xFFFF
+        self.write_reading((self.head + self.count) % self.max, r)
+        self.count += 1
+        self.write_byte(0, self.count)
+        self.write_seq()
+        return True
+
+    def overrun_lossy(self):
+        # full: the oldest reading goes if only lossy cursors still have to read it
+        if any(self.cursor[c] == 0 and not self.lossy[c] for c in (0, 1)):
+            return False
+        return self.pop_n(1) == 1
+
+    def newest_unread(self):
+        return all(c < self.count for c in self.cursor)
+
+    def push_or_replace(self, duration, ts, flags, sub_events=1):
+        if self.count and self.newest_unread():
+            i = (self.head + self.count - 1) % self.max
+            n = self.slots[i]
+            if n[3] & FLAG_IN_PROGRESS and n[1] == ts:
+                r = (duration, ts, self.next_seq, flags, sub_events)
+                self.next_seq = (self.next_seq + 1) & 0xFFFF
+                self.write_reading(i, r)
+                self.write_seq()
+                return True
+        return self.push(duration, ts, flags, sub_events)
+
+    def pending(self, c=CURSOR_CLOUD):
+        return self.count - self.cursor[c]
+
+    def peek_next(self, c=CURSOR_CLOUD):
+        if self.cursor[c] >= self.count:
+            return None
+        return self.slots[(self.head + self.cursor[c]) % self.max]
+
+    def set_cursor(self, c, pos):
+        self.cursor[c] = pos
+        self.write_byte(6 + c, pos)
+
+    def pop_n(self, n):
+        n = min(n, self.count)
+        if not n:
+            return 0
+        self.head = (self.head + n) % self.max
+        self.count -= n
+        self.write_byte(1, self.head)
+        self.write_byte(0, self.count)
+        for c in (0, 1):
+            self.lost[c] += max(n - self.cursor[c], 0)
+            self.set_cursor(c, max(self.cursor[c] - n, 0))
+        return n
+
+    def advance(self, c, n):
+        n = min(n, self.pending(c))
+        if not n:
+            return 0
+        self.cursor[c] += n
+        reclaim = min([self.count] + self.cursor)
+        if not self.pop_n(reclaim):
+            self.set_cursor(c, self.cursor[c])
+        return n
+
+
+class Device:
+    """One simulated board. Times are float seconds on the virtual clock."""
+
+    # ESP states
+    OFF, BOOTING, READY, SENDING, ERROR = range(5)
+
+    def __init__(self, cfg, outages=(), seed=1):
+        self.cfg = cfg
+        self.rng = random.Random(seed)
+        self.outages = sorted(outages)
+        self.outage_starts = [s for s, _ in self.outages]
+        self.st = Storage(cfg.max_entries, cfg.export_blocking)
+        # motion
+        self.active = self.closing = self.alert_armed = False
+        self.start = self.end = self.last_checkpoint = 0.0
+        self.started_in_warmup = False
+        self.sub_events = 0
+        self.alert_pending = False
+        self.alert_ts = 0.0
+        self.level = 0
+        # esp
+        self.esp = self.BOOTING if cfg.esp_on else self.OFF
+        self.esp_at = cfg.join_s if cfg.esp_on else None  # when the current ESP step completes
+        self.boot_start = 0.0
+        self.in_flight = None  # ("alert", ts) | ("reading", seq, event_end)
+        self.last_send = -1e12
+        self.last_reply = -1e12  # ESP01Driver::lastReplyTime(): entry id or "0" back
+        self.last_accept = -1e12
+        # results
+        self.m = {"pulses": 0, "events": 0, "merged": 0, "checkpoints": 0, "warmup_dropped": 0,
+                  "stored": 0, "dropped": 0, "attempts": 0, "delivered": 0, "rate_limited": 0,
+                  "failed": 0, "outage_failures": 0, "esp_restarts": 0, "alerts_raised": 0,
+                  "alerts_delivered": 0}
+        self.latency = []
+        self.alert_latency = []
+        self.depth_area = 0.0
+        self.full_time = 0.0
+        self.max_depth = 0
+        self.depth_t = 0.0
+
+    # --- helpers ---------------------------------------------------------------
+    def in_outage(self, t):
+        i = bisect.bisect_right(self.outage_starts, t) - 1
+        return i >= 0 and t < self.outages[i][1]
+
+    def track_depth(self, t):
+        # readings waiting for upload; a lossy export cursor keeps the rest of the ring filled
+        d = self.st.pending()
+        self.depth_area += d * (t - self.depth_t)
+        if d >= self.cfg.max_entries:
+            self.full_time += t - self.depth_t
+        self.depth_t = t
+        self.max_depth = max(self.max_depth, d)
+
+    def store(self, t, duration, flags):
+        if self.started_in_warmup:
+            flags |= FLAG_WARMUP
+        if self.st.push_or_replace(int(duration * 1000), int(self.start * 1000), flags, self.sub_events):
+            if not flags & FLAG_IN_PROGRESS:
+                self.m["stored"] += 1
+        else:
+            self.m["dropped"] += 1
+
+    # --- MotionDetectorCore ----------------------------------------------------
+    def edge(self, t, level):
+        self.track_depth(t)
+        self.level = level
+        if t < self.cfg.warmup_s:
+            if level:
+                self.m["warmup_dropped"] += 1
+            return
+        if level:
+            self.m["pulses"] += 1
+            if self.closing:
+                self.closing = False
+                self.sub_events += 1
+                self.m["merged"] += 1
+                return
+            self.start = self.last_checkpoint = t
+            self.sub_events = 1
+            self.active = True
+            self.started_in_warmup = False
+            self.alert_armed = self.cfg.alerts
+        elif self.active:
+            self.end = t
+            self.closing = True
+            self.alert_armed = False
+
+    def motion_due(self):
+        if not self.active:
+            return None
+        due = []
+        if self.closing:
+            due.append(self.end + self.cfg.merge_gap_s)
+        if self.cfg.checkpoint_interval_s:
+            due.append(self.last_checkpoint + self.cfg.checkpoint_interval_s)
+        if self.alert_armed:
+            due.append(self.start + self.cfg.alert_debounce_s)
+        return min(due)
+
+    # due times and the checks below use the same sums, so a timer is never due but not taken
+    def service_motion(self, t):
+        if not self.active:
+            return
+        if self.closing and t >= self.end + self.cfg.merge_gap_s:
+            self.m["events"] += 1
+            self.store(t, self.end - self.start, 0)
+            self.active = self.closing = False
+            return
+        if self.cfg.checkpoint_interval_s and t >= self.last_checkpoint + self.cfg.checkpoint_interval_s:
+            self.last_checkpoint = t
+            self.m["checkpoints"] += 1
+            self.store(t, (self.end if self.closing else t) - self.start, FLAG_IN_PROGRESS)
+        if self.alert_armed and t >= self.start + self.cfg.alert_debounce_s:
+            # a newer start replaces an undelivered alert
+            self.alert_armed = False
+            self.alert_pending = True
+            self.alert_ts = self.start
+            self.m["alerts_raised"] += 1
+
+    # --- ESP01Driver -----------------------------------------------------------
+    def service_esp(self, t):
+        if self.esp_at is None or t < self.esp_at:
+            return
+        cfg = self.cfg
+        if self.esp == self.BOOTING:
+            if self.in_outage(t):
+                # join fails; stuck in BOOTING until the supervisor restarts the module
+                self.esp, self.esp_at = self.ERROR, self.boot_start + cfg.recovery_s
+                if self.esp_at <= t:
+                    self.esp_at = t + cfg.recovery_s
+            else:
+                self.esp, self.esp_at = self.READY, None
+        elif self.esp == self.ERROR:
+            self.m["esp_restarts"] += 1
+            self.esp, self.boot_start, self.esp_at = self.BOOTING, t, t + cfg.join_s
+        elif self.esp == self.SENDING:
+            self.finish_request(t)
+
+    def finish_request(self, t):
+        cfg = self.cfg
+        kind = self.in_flight[0]
+        if self.in_outage(t):
+            # CIPSTART ERROR / no reply: the supervisor restarts the module
+            self.m["failed"] += 1
+            self.m["outage_failures"] += 1
+            self.esp, self.esp_at = self.ERROR, t + cfg.recovery_s
+        elif self.rng.random() < cfg.request_fail_p:
+            self.m["failed"] += 1
+            self.esp, self.esp_at = self.READY, None
+        elif t - self.last_accept < cfg.server_rate_limit_s:
+            self.m["rate_limited"] += 1
+            self.last_reply = t
+            self.esp, self.esp_at = self.READY, None
+        else:
+            self.last_accept = self.last_reply = t
+            self.esp, self.esp_at = self.READY, None
+            if kind == "alert":
+                self.m["alerts_delivered"] += 1
+                self.alert_latency.append(t - self.in_flight[1])
+                if self.alert_pending and self.alert_ts == self.in_flight[1]:
+                    self.alert_pending = False
+            else:
+                r = self.st.peek_next()
+                if r is not None and r[2] == self.in_flight[1]:
+                    self.track_depth(t)
+                    self.st.advance(Storage.CURSOR_CLOUD, 1)
+                    self.m["delivered"] += 1
+                    self.latency.append(t - self.in_flight[2])
+        self.in_flight = None
+
+    # --- MainController loop() send logic --------------------------------------
+    def send_due(self):
+        if self.esp != self.READY:
+            return None
+        due = []
+        if self.alert_pending:
+            due.append(self.alert_slot())
+        if self.st.pending():
+            due.append(self.last_send + self.cfg.min_interval_s)
+        return min(due) if due else None
+
+    def alert_slot(self):
+        # ALERT_MIN_INTERVAL from both the last request's start and ThingSpeak's last reply
+        return max(self.last_send, self.last_reply) + self.cfg.alert_min_interval_s
+
+    def service_send(self, t):
+        if self.esp != self.READY:
+            return
+        cfg = self.cfg
+        if self.alert_pending and t >= self.alert_slot():
+            self.in_flight = ("alert", self.alert_ts)
+        elif self.st.pending() and t >= self.last_send + cfg.min_interval_s:
+            r = self.st.peek_next()
+            self.in_flight = ("reading", r[2], (r[1] + r[0]) / 1000.0)
+        else:
+            return
+        self.m["attempts"] += 1
+        self.last_send = t
+        self.esp = self.SENDING
+        self.esp_at = t + cfg.request_s * (0.5 + self.rng.random())
+
+    # --- driver ------------------------------------------------------------------
+    def next_due(self):
+        due = [d for d in (self.motion_due(), self.esp_at, self.send_due()) if d is not None]
+        return min(due) if due else None
+
+    def step(self, t):
+        self.service_motion(t)
+        self.service_esp(t)
+        self.service_send(t)
+
+
+def run(cfg, pulses, duration_s, outages=(), seed=1, series_every=None, keep_latencies=False):
+    """Replay pulses [(rise_s, fall_s), ...] for duration_s; returns the result dict
+    (with every reading's latency under "latencies" if asked, for pooling runs)."""
+    dev = Device(cfg, outages, seed)
+    series = []
+    next_sample = 0.0 if series_every else None
+    # one PIR output: overlapping pulses (e.g. from a trace) are one high period
+    edges = []
+    for rise, fall in sorted(pulses):
+        if rise >= duration_s:
+            break
+        if edges and rise <= edges[-1][0]:
+            edges[-1] = (max(edges[-1][0], min(fall, duration_s)), 0)
+            continue
+        edges.append((rise, 1))
+        edges.append((min(fall, duration_s), 0))
+    i = 0
+    t = 0.0
+    while True:
+        due = dev.next_due()
+        t_edge = edges[i][0] if i < len(edges) else None
+        cands = [x for x in (due, t_edge, next_sample) if x is not None]
+        if not cands:
+            break
+        t = max(t, min(cands))
+        if t >= duration_s:
+            break
+        if next_sample is not None and t >= next_sample:
+            series.append((next_sample, dev.st.count))
+            next_sample += series_every
+        while i < len(edges) and edges[i][0] <= t:
+            dev.edge(t, edges[i][1])
+            i += 1
+        dev.step(t)
+    dev.track_depth(duration_s)
+    res = summarize(dev, duration_s, series)
+    if keep_latencies:
+        res["latencies"] = dev.latency
+    return res
+
+
+def percentile(xs, q):
+    if not xs:
+        return None
+    xs = sorted(xs)
+    return xs[min(len(xs) - 1, int(q * len(xs)))]
+
+
+def summarize(dev, duration_s, series):
+    m = dict(dev.m)
+    st = dev.st
+    hottest = max(range(EEPROM_SIZE), key=lambda a: st.wear[a])
+    writes = sum(st.wear)
+    days = duration_s / 86400.0
+    res = {
+        "days": round(days, 3),
+        "queue_max": dev.max_depth,
+        "queue_mean": round(dev.depth_area / duration_s, 3) if duration_s else 0,
+        "queue_full_pct": round(100.0 * dev.full_time / duration_s, 3) if duration_s else 0,
+        "queue_end": st.pending(),
+        "drop_pct": round(100.0 * m["dropped"] / max(1, m["stored"] + m["dropped"]), 3),
+        "export_lost": st.lost[Storage.CURSOR_EXPORT],
+        "eeprom_writes": writes,
+        "eeprom_hot_cell": hottest,
+        "eeprom_hot_writes": st.wear[hottest],
+        "eeprom_life_years": round(EEPROM_ENDURANCE / (st.wear[hottest] / days) / 365.0, 2)
+        if st.wear[hottest] and days else None,
+        "latency_p50_s": percentile(dev.latency, 0.5),
+        "latency_p95_s": percentile(dev.latency, 0.95),
+        "latency_max_s": max(dev.latency) if dev.latency else None,
+        "alert_latency_p95_s": percentile(dev.alert_latency, 0.95),
+    }
+    for k in ("latency_p50_s", "latency_p95_s", "latency_max_s", "alert_latency_p95_s"):
+        if res[k] is not None:
+            res[k] = round(res[k], 2)
+    m.update(res)
+    if series:
+        m["series"] = series
+    return m
+
+
+# --- traffic sources --------------------------------------------------------------------------
+
+LOG_RE = re.compile(r"^(\d+):(\d+):(\d+)\.(\d+)\s*->\s*\[PIR\] Stored duration = (\d+) sec")
+
+
+def pulses_from_log(path):
+    """'HH:MM:SS.mmm -> [PIR] Stored duration = N sec' lines: the event ended at the time stamp."""
+    out, day, last = [], 0.0, None
+    with open(path, encoding="utf-8", errors="replace") as f:
+        for line in f:
+            m = LOG_RE.match(line.strip())
+            if not m:
+                continue
+            h, mi, s, ms, dur = (int(x) for x in m.groups())
+            t = h * 3600 + mi * 60 + s + ms / 1000.0 + day
+            if last is not None and t < last:
+                day += 86400.0  # past midnight
+                t += 86400.0
+            last = t
+            out.append((t - max(dur, 0.5), t))
+    return normalize(out)
+
+
+def pulses_from_csv(path):
+    """export_decode.py CSV (ts_ms, duration_ms columns); checkpoints are skipped."""
+    import csv
+    out = []
+    with open(path, newline="") as f:
+        for row in csv.DictReader(f):
+            if int(row.get("flags", 0)) & FLAG_IN_PROGRESS:
+                continue
+            start = int(row["ts_ms"]) / 1000.0
+            out.append((start, start + max(int(row["duration_ms"]) / 1000.0, 0.5)))
+    return normalize(out)
+
+
+def normalize(pulses):
+    pulses.sort()
+    if not pulses:
+        raise SystemExit("no PIR events found in the trace")
+    t0 = pulses[0][0]
+    return [(a - t0, b - t0) for a, b in pulses]
+
+
+def tile(pulses, duration_s, offset_s=0.0):
+    """Repeat a recorded trace back to back until duration_s is covered."""
+    span = pulses[-1][1] + (pulses[-1][1] - pulses[0][0]) / max(1, len(pulses))
+    out, base = [], offset_s
+    while base < duration_s:
+        out.extend((a + base, b + base) for a, b in pulses)
+        base += span
+    return out
+
+
+def poisson_pulses(rng, rate_per_h, mean_duration_s, start_s, end_s):
+    out, t = [], start_s
+    while rate_per_h > 0:
+        t += rng.expovariate(rate_per_h / 3600.0)
+        if t >= end_s:
+            break
+        d = max(1.0, rng.expovariate(1.0 / mean_duration_s))
+        out.append((t, t + d))
+        t += d
+    return out
+
+
+def bursty_pulses(rng, rate_per_h, burst_rate_per_h, burst_len_s, quiet_len_s, mean_duration_s, duration_s):
+    """Quiet periods at rate_per_h alternating with bursts at burst_rate_per_h (exponential lengths)."""
+    out, t, burst = [], 0.0, False
+    while t < duration_s:
+        length = rng.expovariate(1.0 / (burst_len_s if burst else quiet_len_s))
+        end = min(t + length, duration_s)
+        out.extend(poisson_pulses(rng, burst_rate_per_h if burst else rate_per_h, mean_duration_s, t, end))
+        t, burst = end, not burst
+    return out
+
+
+def add_config_args(ap):
+    """One --name option per Config field (dashes for underscores)."""
+    for f in fields(Config):
+        name = "--" + f.name.replace("_", "-")
+        if f.type in (bool, "bool"):
+            ap.add_argument(name, type=lambda s: s.lower() in ("1", "true", "yes", "on"), default=f.default,
+                            metavar="BOOL", help="default %s" % f.default)
+        else:
+            ap.add_argument(name, type=type(f.default), default=f.default, help="default %s" % f.default)
+
+
+def config_from_args(args):
+    return Config(**{f.name: getattr(args, f.name) for f in fields(Config)})
+
+
+def add_traffic_args(ap):
+    src = ap.add_mutually_exclusive_group(required=True)
+    src.add_argument("--log", help="serial log with '[PIR] Stored duration' lines")
+    src.add_argument("--csv", help="export_decode.py CSV")
+    src.add_argument("--poisson", type=float, metavar="PER_HOUR", help="events per hour")
+    src.add_argument("--bursty", type=float, metavar="PER_HOUR", help="events per hour between bursts")
+    ap.add_argument("--burst-rate", type=float, default=240.0, help="events per hour inside a burst")
+    ap.add_argument("--burst-len", type=float, default=600.0, help="mean burst length, s")
+    ap.add_argument("--quiet-len", type=float, default=3600.0, help="mean time between bursts, s")
+    ap.add_argument("--mean-duration", type=float, default=5.0, help="mean PIR pulse length, s")
+    ap.add_argument("--days", type=float, default=30.0)
+    ap.add_argument("--seed", type=int, default=1)
+    ap.add_argument("--outage", action="append", default=[], metavar="START_S:DURATION_S",
+                    help="Wi-Fi/cloud outage, repeatable")
+
+
+def traffic_from_args(args, seed=None):
+    """(pulses, duration_s, outages) for the traffic options; seed overrides --seed."""
+    duration = args.days * 86400.0
+    rng = random.Random(args.seed if seed is None else seed)
+    if args.log or args.csv:
+        trace = pulses_from_log(args.log) if args.log else pulses_from_csv(args.csv)
+        # the warm-up would swallow the start of every replay: shift the trace past it
+        pulses = tile(trace, duration, offset_s=Config.warmup_s)
+    elif args.poisson is not None:
+        pulses = poisson_pulses(rng, args.poisson, args.mean_duration, 0.0, duration)
+    else:
+        pulses = bursty_pulses(rng, args.bursty, args.burst_rate, args.burst_len, args.quiet_len,
+                               args.mean_duration, duration)
+    outages = []
+    for spec in args.outage:
+        start, length = (float(x) for x in spec.split(":"))
+        outages.append((start, start + length))
+    return pulses, duration, outages
+
+
+def print_summary(res, pulses, secs, out):
+    w = out.write
+    w("replayed %.1f days: %d PIR pulses -> %d events (%d merged, %d checkpoints) in %.2f s (%.0fx real time)\n"
+      % (res["days"], len(pulses), res["events"], res["merged"], res["checkpoints"], secs,
+         res["days"] * 86400.0 / secs if secs else 0))
+    w("queue:   max %d, mean %.2f, full %.2f%% of the time, %d left at the end\n"
+      % (res["queue_max"], res["queue_mean"], res["queue_full_pct"], res["queue_end"]))
+    w("drops:   %d readings (%.2f%%), %d warm-up pulses ignored, %d overwritten before export\n"
+      % (res["dropped"], res["drop_pct"], res["warmup_dropped"], res["export_lost"]))
+    w("eeprom:  %d byte writes, hottest cell %d with %d writes -> %s years to %d cycles\n"
+      % (res["eeprom_writes"], res["eeprom_hot_cell"], res["eeprom_hot_writes"],
+         res["eeprom_life_years"], EEPROM_ENDURANCE))
+    w("uploads: %d attempts, %d readings delivered, %d alerts delivered, %d rate-limited (\"0\"), "
+      "%d failed (%d in outages), %d ESP restarts\n"
+      % (res["attempts"], res["delivered"], res["alerts_delivered"], res["rate_limited"], res["failed"],
+         res["outage_failures"], res["esp_restarts"]))
+    w("latency: event end -> entry id p50 %s s, p95 %s s, max %s s; alert p95 %s s\n"
+      % (res["latency_p50_s"], res["latency_p95_s"], res["latency_max_s"], res["alert_latency_p95_s"]))
+
+
+def main():
+    ap = argparse.ArgumentParser(description=__doc__, formatter_class=argparse.RawDescriptionHelpFormatter)
+    add_traffic_args(ap)
+    ap.add_argument("--series", help="CSV of queue depth sampled every --sample seconds")
+    ap.add_argument("--sample", type=float, default=300.0)
+    ap.add_argument("--json", help="write the result as JSON")
+    add_config_args(ap.add_argument_group("model parameters (MainController.ino / ESP01Driver.h)"))
+    args = ap.parse_args()
+
+    cfg = config_from_args(args)
+    pulses, duration, outages = traffic_from_args(args)
+    t0 = time.perf_counter()
+    res = run(cfg, pulses, duration, outages, args.seed, args.sample if args.series else None)
+    secs = time.perf_counter() - t0
+    series = res.pop("series", [])
+    print_summary(res, pulses, secs, sys.stdout)
+    if args.series:
+        with open(args.series, "w") as f:
+            f.write("t_h,queue_depth\n")
+            for t, d in series:
+                f.write("%.3f,%d\n" % (t / 3600.0, d))
+    if args.json:
+        with open(args.json, "w") as f:
+            json.dump({"config": asdict(cfg), "result": res}, f, indent=2)
+
+
+if __name__ == "__main__":
+    main()
@@ -0,0 +1,122 @@
+#!/usr/bin/env python3
+"""Burst test for the sketch's ESP receive path: how many bytes SoftwareSerial drops.
+
+    python3 rx_burst.py --esp-port /dev/ttyUSB1 --device-port /dev/ttyACM0
+    python3 rx_burst.py --esp-port /dev/ttyUSB1 --device-port /dev/ttyACM0 --sizes 64,256,1024 --repeat 5
+
+The ESP01 emulator (esp01_emulator.py) runs on --esp-port, wired where the module goes. The
+board's USB port is read with the binary protocol (motionlink.py). Once the sketch has joined
+(the tool powers the ESP on if it is off), each burst of filler lines is written back to back
+while the link is idle. The bytes written are compared with the sketch's RxBytes counter:
+
+    lost = bytes the emulator wrote - increase of RxBytes
+
+RxOverflows and RxTruncated are reported next to it. The link runs at the rate the sketch
+negotiated at power-on (ESP_MAX_BAUD), shown in the table. SoftwareSerial buffers 64 bytes, so
+bursts up to that size must never lose anything. Longer ones show whether the sketch drains the
+port fast enough (ESP01Driver::rxDrainIntervalMs()). Needs pyserial.
+"""
+
+import argparse
+import sys
+import threading
+import time
+
+import esp01_emulator as emulator
+import motionlink
+
+
+class EmulatorThread(threading.Thread):
+    """Keeps the emulated module answering while the main thread talks to the board."""
+
+    def __init__(self, esp):
+        super().__init__(daemon=True)
+        self.esp = esp
+        self.lock = threading.Lock()
+
+    def run(self):
+        while True:
+            with self.lock:
+                self.esp.step()
+            time.sleep(0.001)
+
+    def tx_bytes(self):
+        with self.lock:
+            return self.esp.stats["tx_bytes"]
+
+    def burst(self, nbytes, timeout=30.0):
+        deadline = time.monotonic() + timeout
+        while time.monotonic() < deadline:
+            with self.lock:
+                if self.esp.idle():
+                    self.esp.burst(nbytes)
+                    return
+            time.sleep(0.01)
+        raise TimeoutError("the ESP link never went idle")
+
+
+def wait_ready(dev, timeout):
+    deadline = time.monotonic() + timeout
+    while time.monotonic() < deadline:
+        st, _ = dev.status()
+        if st["esp_state"] == "READY":
+            return
+        if st["esp_state"] == "OFF":
+            dev.command(motionlink.CMD_ESP_ON)
+        time.sleep(0.5)
+    raise TimeoutError("the sketch did not reach READY")
+
+
+def main():
+    ap = argparse.ArgumentParser(description=__doc__, formatter_class=argparse.RawDescriptionHelpFormatter)
+    ap.add_argument("--esp-port", required=True, help="USB-UART wired in place of the ESP01")
+    ap.add_argument("--device-port", required=True, help="the board's USB serial port")
+    ap.add_argument("--baud", type=int, default=115200, help="the board's USB serial rate")
+    ap.add_argument("--no-reset-wait", action="store_true", help="port does not reset the board on open")
+    ap.add_argument("--sizes", default="32,64,96,128,256,512,1024", help="burst sizes in bytes")
+    ap.add_argument("--repeat", type=int, default=3, help="bursts per size")
+    ap.add_argument("--settle", type=float, default=1.0, help="seconds allowed for the sketch to drain a burst")
+    args = ap.parse_args()
+
+    import serial  # pyserial
+    em_args = emulator.build_arg_parser().parse_args(["--port", args.esp_port])
+    esp = emulator.Esp01(emulator.SerialTransport(args.esp_port, emulator.ESP_BAUD_DEFAULT),
+                         emulator.BuiltinThingSpeak(), emulator.Faults(em_args))
+    em = EmulatorThread(esp)
+    em.start()
+
+    port = serial.Serial(args.device_port, args.baud, timeout=0.01)
+    if not args.no_reset_wait:
+        time.sleep(2.0)  # opening the port resets an Uno
+    dev = motionlink.Device(port)
+    wait_ready(dev, 60.0)
+    print("link baud %d" % esp.baud)
+    print("%8s %8s %8s %8s %6s %10s %10s" % ("burst", "bursts", "sent", "received", "lost", "overflows", "truncated"))
+
+    worst = 0
+    for size in [int(x) for x in args.sizes.split(",")]:
+        sent = received = overflows = truncated = 0
+        for _ in range(args.repeat):
+            c0, _ = dev.counters()
+            tx0 = em.tx_bytes()
+            em.burst(size)
+            time.sleep(args.settle)
+            tx1 = em.tx_bytes()
+            c1, _ = dev.counters()
+            # any other traffic in the window is on both sides of the comparison
+            sent += tx1 - tx0
+            received += (c1["rx_bytes"] - c0["rx_bytes"]) & 0xFFFFFFFF
+            overflows += (c1["rx_overflows"] - c0["rx_overflows"]) & 0xFFFF
+            truncated += (c1["rx_truncated_lines"] - c0["rx_truncated_lines"]) & 0xFFFF
+        lost = sent - received
+        if size <= 64:
+            worst = max(worst, lost)
+        print("%8d %8d %8d %8d %6d %10d %10d" % (size, args.repeat, sent, received, lost, overflows, truncated))
+    port.close()
+    if worst:
+        print("bytes lost from bursts that fit the 64-byte RX buffer", file=sys.stderr)
+        sys.exit(1)
+
+
+if __name__ == "__main__":
+    main()
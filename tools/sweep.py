@@ -0,0 +1,187 @@
+#!/usr/bin/env python3
+"""Sweep queue and upload settings over traffic and outage profiles, on every core.
+
+    python3 sweep.py --grid max_entries=10,20,40,84 --grid min_interval_s=15,20,30 \\
+        --grid merge_gap_s=0,5,15 --profile poisson:40 --profile bursty:5:300:600:3600 \\
+        --outages none --outages daily:1800 --seeds 5 --days 14 --csv sweep.csv
+
+Each run is one simulated device from replay.py (same model, same caveats: it mirrors the
+sketch's logic, it does not execute the sketch). Runs are independent and spread over a process
+pool, one per core by default; every (settings, profile, outages) cell is repeated with --seeds
+different seeds and the results are pooled.
+
+--grid NAME=V1,V2,... takes any replay.Config field (see replay.py --help); the default is
+MainController.ino's value. Profiles:
+    poisson:PER_HOUR[:MEAN_DURATION_S]
+    bursty:PER_HOUR:BURST_PER_HOUR:BURST_LEN_S:QUIET_LEN_S[:MEAN_DURATION_S]
+    log:PATH                       (serial log, tiled; see replay.py --log)
+Outages:
+    none | daily:SECONDS (one outage a day at a random time) | every:PERIOD_S:SECONDS
+
+The table gives, per cell: drop rate, EEPROM writes per day on the hottest cell and the years
+until it reaches 100k cycles, p95 event-to-upload latency (pooled over seeds), uploads per
+reading and the share of requests ThingSpeak answered with "0". Rows within --max-drop are
+ranked by p95 latency, then wear; --csv writes every cell.
+"""
+
+import argparse
+import csv
+import itertools
+import multiprocessing
+import os
+import random
+import sys
+import time
+from dataclasses import fields
+
+import replay
+
+CONFIG_TYPES = {f.name: type(f.default) for f in fields(replay.Config)}
+
+
+def parse_grid(specs):
+    grid = {}
+    for spec in specs:
+        name, _, values = spec.partition("=")
+        if name not in CONFIG_TYPES:
+            raise SystemExit("unknown parameter %r (one of: %s)" % (name, ", ".join(CONFIG_TYPES)))
+        conv = CONFIG_TYPES[name]
+        if conv is bool:
+            conv = lambda s: s.lower() in ("1", "true", "yes", "on")
+        grid[name] = [conv(v) for v in values.split(",")]
+    return grid
+
+
+def make_pulses(profile, days, rng):
+    kind, _, rest = profile.partition(":")
+    duration = days * 86400.0
+    if kind == "log":
+        return replay.tile(replay.pulses_from_log(rest), duration, offset_s=replay.Config.warmup_s)
+    args = [float(x) for x in rest.split(":")]
+    if kind == "poisson":
+        mean = args[1] if len(args) > 1 else 5.0
+        return replay.poisson_pulses(rng, args[0], mean, 0.0, duration)
+    if kind == "bursty":
+        mean = args[4] if len(args) > 4 else 5.0
+        return replay.bursty_pulses(rng, args[0], args[1], args[2], args[3], mean, duration)
+    raise ValueError("unknown profile %r" % profile)
+
+
+def make_outages(spec, days, rng):
+    kind, _, rest = spec.partition(":")
+    duration = days * 86400.0
+    if kind == "none":
+        return []
+    args = [float(x) for x in rest.split(":")]
+    if kind == "daily":
+        return [(d * 86400.0 + s, d * 86400.0 + s + args[0])
+                for d in range(int(days + 0.999)) for s in [rng.uniform(0, 86400.0 - args[0])]
+                if d * 86400.0 + s < duration]
+    if kind == "every":
+        period, length = args
+        n = int(duration // period)
+        return [(k * period + period - length, k * period + period) for k in range(n)]
+    raise ValueError("unknown outage profile %r" % spec)
+
+
+def run_one(job):
+    """Worker: one device, one seed. Traffic is generated here so only the job is pickled."""
+    settings, profile, outage_spec, seed, days = job
+    rng = random.Random(seed)
+    pulses = make_pulses(profile, days, rng)
+    outages = make_outages(outage_spec, days, rng)
+    cfg = replay.Config(**settings)
+    res = replay.run(cfg, pulses, days * 86400.0, outages, seed, keep_latencies=True)
+    return job, res, res.pop("latencies")
+
+
+def pooled(results):
+    """Combine the seeds of one cell."""
+    n = len(results)
+    stored = sum(r["stored"] for r, _ in results)
+    dropped = sum(r["dropped"] for r, _ in results)
+    delivered = sum(r["delivered"] for r, _ in results)
+    attempts = sum(r["attempts"] for r, _ in results)
+    lat = sorted(x for _, l in results for x in l)
+    days = sum(r["days"] for r, _ in results)
+    hot = max(r["eeprom_hot_writes"] / r["days"] for r, _ in results)
+    return {
+        "runs": n,
+        "drop_pct": round(100.0 * dropped / max(1, stored + dropped), 2),
+        "hot_writes_per_day": round(hot, 1),
+        "life_years": round(replay.EEPROM_ENDURANCE / hot / 365.0, 2) if hot else None,
+        "p95_latency_s": round(lat[min(len(lat) - 1, int(0.95 * len(lat)))], 1) if lat else None,
+        "readings_per_day": round(delivered / days, 1) if days else 0,
+        "uploads_per_reading": round(attempts / delivered, 2) if delivered else None,
+        "rate_limited_pct": round(100.0 * sum(r["rate_limited"] for r, _ in results) / max(1, attempts), 2),
+    }
+
+
+def main():
+    ap = argparse.ArgumentParser(description=__doc__, formatter_class=argparse.RawDescriptionHelpFormatter)
+    ap.add_argument("--grid", action="append", default=[], metavar="NAME=V1,V2,...")
+    ap.add_argument("--profile", action="append", default=[], help="traffic profile, repeatable")
+    ap.add_argument("--outages", action="append", default=[], help="outage profile, repeatable")
+    ap.add_argument("--seeds", type=int, default=3, help="runs per cell")
+    ap.add_argument("--days", type=float, default=7.0)
+    ap.add_argument("--jobs", type=int, default=os.cpu_count(), help="worker processes")
+    ap.add_argument("--max-drop", type=float, default=1.0, help="drop %% allowed for a row to be ranked")
+    ap.add_argument("--top", type=int, default=20, help="rows printed")
+    ap.add_argument("--csv", help="write every cell here")
+    args = ap.parse_args()
+
+    grid = parse_grid(args.grid)
+    profiles = args.profile or ["poisson:40"]
+    outage_specs = args.outages or ["none"]
+    names = list(grid)
+    settings_list = [dict(zip(names, combo)) for combo in itertools.product(*grid.values())] or [{}]
+    jobs = [(s, p, o, seed, args.days)
+            for s in settings_list for p in profiles for o in outage_specs for seed in range(1, args.seeds + 1)]
+
+    t0 = time.perf_counter()
+    cells = {}
+    with multiprocessing.Pool(args.jobs) as pool:
+        for done, (job, res, lat) in enumerate(pool.imap_unordered(run_one, jobs, chunksize=4), 1):
+            settings, profile, outage_spec, _, _ = job
+            cells.setdefault((tuple(sorted(settings.items())), profile, outage_spec), []).append((res, lat))
+            if sys.stderr.isatty():
+                sys.stderr.write("\r%d/%d runs" % (done, len(jobs)))
+    secs = time.perf_counter() - t0
+    if sys.stderr.isatty():
+        sys.stderr.write("\n")
+    print("%d runs (%d cells x %d seeds, %.0f device-days) in %.1f s on %d processes"
+          % (len(jobs), len(cells), args.seeds, len(jobs) * args.days, secs, args.jobs), file=sys.stderr)
+
+    rows = []
+    for (settings, profile, outage_spec), results in cells.items():
+        row = dict(settings)
+        row.update(profile=profile, outages=outage_spec)
+        row.update(pooled(results))
+        rows.append(row)
+    stat_cols = ["drop_pct", "hot_writes_per_day", "life_years", "p95_latency_s", "readings_per_day",
+                 "uploads_per_reading", "rate_limited_pct"]
+    cols = names + ["profile", "outages"] + stat_cols
+
+    if args.csv:
+        with open(args.csv, "w", newline="") as f:
+            w = csv.DictWriter(f, fieldnames=cols + ["runs"])
+            w.writeheader()
+            w.writerows(rows)
+
+    def rank(r):
+        return (r["p95_latency_s"] if r["p95_latency_s"] is not None else float("inf"), r["hot_writes_per_day"])
+
+    for profile, outage_spec in itertools.product(profiles, outage_specs):
+        group = [r for r in rows if r["profile"] == profile and r["outages"] == outage_spec]
+        ok = sorted((r for r in group if r["drop_pct"] <= args.max_drop), key=rank)
+        rest = sorted((r for r in group if r["drop_pct"] > args.max_drop), key=lambda r: r["drop_pct"])
+        print("\n%s, outages %s: %d of %d settings drop <= %.2f%%" % (profile, outage_spec, len(ok), len(group),
+                                                                      args.max_drop))
+        widths = [max(len(c), 8) for c in cols]
+        print("  ".join(c.rjust(w) for c, w in zip(cols, widths)))
+        for r in (ok + rest)[:args.top]:
+            print("  ".join(str(r[c]).rjust(w) for c, w in zip(cols, widths)))
+
+
+if __name__ == "__main__":
+    main()
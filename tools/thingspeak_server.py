@@ -0,0 +1,235 @@
+#!/usr/bin/env python3
+"""Local stand-in for the ThingSpeak write API, for end-to-end upload benchmarks without the internet.
+
+    python3 thingspeak_server.py --listen 127.0.0.1:8080 --rate-limit 15 --log requests.csv
+    python3 esp01_emulator.py --port /dev/ttyUSB1 --server 127.0.0.1:8080
+
+The sketch's requests reach it through the ESP01 emulator (its CIPSTART opens a real TCP
+connection here), so the unmodified driver is measured including HTTP framing and keep-alive.
+
+Endpoints (as on api.thingspeak.com):
+    GET|POST /update[.json]?api_key=KEY&field1=...     -> entry id, or "0" when rejected
+    POST /channels/<id>/bulk_update.json                 -> 202 {"success":true} or 429
+         {"write_api_key": KEY, "updates": [{"delta_t": s | "created_at": ..., "field1": ...}, ...]}
+    GET /stats                                           -> summary below, as JSON
+Connections are HTTP/1.1 keep-alive unless the request says "Connection: close". Within
+--rate-limit seconds of the last accepted write an update answers "0" and a bulk update 429.
+
+Every request is timed; --log writes one CSV row per request (arrival, connection and request
+number on it, handling time, status, entry id, seq). On exit (Ctrl-C) the summary gives the
+accepted/rejected counts, keep-alive reuse and delivered events per minute (readings with a
+field3 seq, duplicates counted once) over the span from the first to the last delivery.
+"""
+
+import argparse
+import csv
+import itertools
+import json
+import re
+import sys
+import threading
+import time
+from http.server import BaseHTTPRequestHandler, ThreadingHTTPServer
+from urllib.parse import parse_qs, urlsplit
+
+
+class Channel:
+    """Entry store with ThingSpeak's per-channel write rate limit. Thread safe."""
+
+    def __init__(self, rate_limit_s=15.0, api_key=None):
+        self.rate_limit_s = rate_limit_s
+        self.api_key = api_key
+        self.lock = threading.Lock()
+        self.entries = []          # (entry_id, time, fields)
+        self.last_write = None
+        self.rejected = 0
+
+    def _limited(self, now):
+        return self.rate_limit_s and self.last_write is not None and now - self.last_write < self.rate_limit_s
+
+    def update(self, key, fields, now=None):
+        """One write; returns the new entry id or 0 (bad key, or inside the rate limit)."""
+        now = time.monotonic() if now is None else now
+        with self.lock:
+            if (self.api_key and key != self.api_key) or self._limited(now):
+                self.rejected += 1
+                return 0
+            self.last_write = now
+            self.entries.append((len(self.entries) + 1, now, fields))
+            return len(self.entries)
+
+    def bulk_update(self, key, updates, now=None):
+        """Many writes counting as one against the rate limit; returns False if rejected."""
+        now = time.monotonic() if now is None else now
+        with self.lock:
+            if (self.api_key and key != self.api_key) or self._limited(now):
+                self.rejected += 1
+                return False
+            self.last_write = now
+            for u in updates:
+                fields = {k: str(v) for k, v in u.items() if k.startswith("field") or k == "status"}
+                self.entries.append((len(self.entries) + 1, now - float(u.get("delta_t", 0)), fields))
+            return True
+
+
+class Recorder:
+    """Per-request timing and the delivered-events/minute summary."""
+
+    FIELDS = ["t", "conn", "req_on_conn", "method", "path", "handle_ms", "status", "entry_id", "seq", "kind"]
+
+    def __init__(self, log_path=None):
+        self.lock = threading.Lock()
+        self.t0 = time.monotonic()
+        self.rows = []
+        self.log = None
+        if log_path:
+            self.log_file = open(log_path, "w", newline="")
+            self.log = csv.DictWriter(self.log_file, fieldnames=self.FIELDS)
+            self.log.writeheader()
+
+    def add(self, row):
+        row["t"] = round(row["t"] - self.t0, 3)
+        with self.lock:
+            self.rows.append(row)
+            if self.log:
+                self.log.writerow(row)
+                self.log_file.flush()
+
+    def summary(self):
+        with self.lock:
+            rows = list(self.rows)
+        accepted = [r for r in rows if r["entry_id"]]
+        delivered = {}
+        for r in accepted:
+            if r["kind"] == "reading" and r["seq"] not in delivered:
+                delivered[r["seq"]] = r["t"]
+        s = {
+            "requests": len(rows),
+            "accepted": len(accepted),
+            "rejected": len(rows) - len(accepted),
+            "connections": len({r["conn"] for r in rows}),
+            "reused_connection": sum(1 for r in rows if r["req_on_conn"] > 1),
+            "alerts": sum(1 for r in accepted if r["kind"] == "alert"),
+            "readings_delivered": len(delivered),
+            "duplicate_readings": sum(1 for r in accepted if r["kind"] == "reading") - len(delivered),
+        }
+        if rows:
+            ms = sorted(r["handle_ms"] for r in rows)
+            s["handle_ms"] = {"median": ms[len(ms) // 2], "max": ms[-1]}
+        if len(delivered) > 1:
+            times = sorted(delivered.values())
+            span = times[-1] - times[0]
+            s["delivered_per_min"] = round((len(times) - 1) * 60.0 / span, 2) if span else None
+        return s
+
+
+def classify(fields):
+    if "field3" in fields:
+        return "reading"
+    if fields.get("field4") == "1":
+        return "alert"
+    return "other"
+
+
+class Handler(BaseHTTPRequestHandler):
+    protocol_version = "HTTP/1.1"
+    server_version = "thingspeak-standin/1"
+    conn_ids = itertools.count(1)
+
+    def setup(self):
+        super().setup()
+        self.conn_id = next(self.conn_ids)
+        self.req_on_conn = 0
+
+    def log_message(self, fmt, *args):
+        if self.server.verbose:
+            sys.stderr.write("%s - %s\n" % (self.address_string(), fmt % args))
+
+    def do_GET(self):
+        self.handle_request()
+
+    def do_POST(self):
+        self.handle_request()
+
+    def handle_request(self):
+        t = time.monotonic()
+        self.req_on_conn += 1
+        url = urlsplit(self.path)
+        length = int(self.headers.get("Content-Length") or 0)
+        body = self.rfile.read(length) if length else b""
+        row = {"t": t, "conn": self.conn_id, "req_on_conn": self.req_on_conn, "method": self.command,
+               "path": url.path, "entry_id": 0, "seq": "", "kind": ""}
+        channel = self.server.channel
+
+        if url.path in ("/update", "/update.json"):
+            params = parse_qs(url.query)
+            if self.command == "POST" and body:
+                params.update(parse_qs(body.decode("latin-1")))
+            fields = {k: v[0] for k, v in params.items() if k != "api_key"}
+            entry = channel.update(params.get("api_key", [""])[0], fields)
+            row.update(entry_id=entry, seq=fields.get("field3", ""), kind=classify(fields))
+            if url.path.endswith(".json"):
+                status, reply = 200, json.dumps({"entry_id": entry, **fields}) if entry else "-1"
+            else:
+                status, reply = 200, str(entry)
+        elif re.fullmatch(r"/channels/\d+/bulk_update\.json", url.path) and self.command == "POST":
+            try:
+                doc = json.loads(body or b"{}")
+                ok = channel.bulk_update(doc.get("write_api_key", ""), doc.get("updates", []))
+            except (ValueError, AttributeError):
+                status, reply, ok = 400, json.dumps({"success": False}), None
+            if ok is not None:
+                status, reply = (202, json.dumps({"success": True})) if ok else (429, json.dumps({"success": False}))
+                row.update(entry_id=len(channel.entries) if ok else 0, kind="bulk")
+        elif url.path == "/stats":
+            status, reply = 200, json.dumps(self.server.recorder.summary())
+        else:
+            status, reply = 404, "0"
+
+        data = reply.encode()
+        self.send_response(status)
+        self.send_header("Content-Type", "application/json" if reply[:1] in "{[" else "text/plain; charset=utf-8")
+        self.send_header("Content-Length", str(len(data)))
+        if self.close_connection:
+            self.send_header("Connection", "close")
+        self.end_headers()
+        self.wfile.write(data)
+        if url.path != "/stats":
+            row.update(status=status, handle_ms=round((time.monotonic() - t) * 1000, 2))
+            self.server.recorder.add(row)
+
+
+def make_server(listen, channel, recorder, verbose=False):
+    host, port = listen.rsplit(":", 1)
+    server = ThreadingHTTPServer((host, int(port)), Handler)
+    server.daemon_threads = True
+    server.channel, server.recorder, server.verbose = channel, recorder, verbose
+    return server
+
+
+def main():
+    ap = argparse.ArgumentParser(description=__doc__, formatter_class=argparse.RawDescriptionHelpFormatter)
+    ap.add_argument("--listen", default="127.0.0.1:8080")
+    ap.add_argument("--rate-limit", type=float, default=15.0, help="seconds between accepted writes (0 = none)")
+    ap.add_argument("--api-key", help="only accept this write key")
+    ap.add_argument("--log", help="CSV file with one row per request")
+    ap.add_argument("--stats", help="write the summary as JSON to this file on exit")
+    ap.add_argument("--verbose", action="store_true")
+    args = ap.parse_args()
+
+    recorder = Recorder(args.log)
+    server = make_server(args.listen, Channel(args.rate_limit, args.api_key), recorder, args.verbose)
+    print("ThingSpeak stand-in on %s:%d" % server.server_address, file=sys.stderr)
+    try:
+        server.serve_forever()
+    except KeyboardInterrupt:
+        pass
+    summary = recorder.summary()
+    print(json.dumps(summary, indent=2), file=sys.stderr)
+    if args.stats:
+        with open(args.stats, "w") as f:
+            json.dump(summary, f, indent=2)
+
+
+if __name__ == "__main__":
+    main()